@@ -125,11 +125,90 @@ void test_any_polynomial()
     }
 }
 
+// Reference bitwise reflected CRC32, as previously used by NVStore
+static uint32_t reference_crc32(uint32_t crc, const uint8_t *data, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+void test_sliced_crc()
+{
+    uint8_t test[128];
+    uint32_t crc;
+
+    for (uint32_t i = 0; i < sizeof(test); i++) {
+        test[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    // Cover every alignment and every tail length of the sliced loop
+    for (uint32_t offset = 0; offset < 4; offset++) {
+        for (uint32_t size = 0; size <= sizeof(test) - 4; size++) {
+            MbedCRC<POLY_32BIT_ANSI, 32> ct;
+            TEST_ASSERT_EQUAL(0, ct.compute((void *)&test[offset], size, &crc));
+            TEST_ASSERT_EQUAL(~reference_crc32(0xFFFFFFFF, &test[offset], size), crc);
+
+            MbedCRC<POLY_32BIT_ANSI, 32> partial(0xFFFFFFFF, 0, true, true);
+            TEST_ASSERT_EQUAL(0, partial.compute_partial_start(&crc));
+            TEST_ASSERT_EQUAL(0, partial.compute_partial((void *)&test[offset], size / 3, &crc));
+            TEST_ASSERT_EQUAL(0, partial.compute_partial((void *)&test[offset + size / 3], size - size / 3, &crc));
+            TEST_ASSERT_EQUAL(0, partial.compute_partial_stop(&crc));
+            TEST_ASSERT_EQUAL(reference_crc32(0xFFFFFFFF, &test[offset], size), crc);
+        }
+    }
+
+    // Non-symmetric initial value must be reflected consistently
+    {
+        MbedCRC<POLY_32BIT_ANSI, 32> ct(0x12345678, 0, true, true);
+        TEST_ASSERT_EQUAL(0, ct.compute((void *)test, sizeof(test), &crc));
+        TEST_ASSERT_EQUAL(reference_crc32(0x1E6A2C48, test, sizeof(test)), crc);
+    }
+}
+
+void test_crc_throughput()
+{
+    static uint8_t test[1024];
+    const int iterations = 64;
+    uint32_t crc;
+    Timer timer;
+
+    memset(test, 0xA5, sizeof(test));
+
+    MbedCRC<POLY_32BIT_ANSI, 32> sliced;
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        TEST_ASSERT_EQUAL(0, sliced.compute((void *)test, sizeof(test), &crc));
+    }
+    timer.stop();
+    int sliced_us = timer.read_us();
+
+    // 32-bit polynomial without ROM tables, computed bitwise
+    MbedCRC<0x1EDC6F41, 32> bitwise(0xFFFFFFFF, 0xFFFFFFFF, 1, 1);
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        TEST_ASSERT_EQUAL(0, bitwise.compute((void *)test, sizeof(test), &crc));
+    }
+    timer.stop();
+    int bitwise_us = timer.read_us();
+
+    printf("CRC32 %d bytes: sliced %dus, bitwise %dus\r\n",
+           iterations * (int)sizeof(test), sliced_us, bitwise_us);
+    TEST_ASSERT(sliced_us <= bitwise_us);
+}
+
 Case cases[] = {
     Case("Test supported polynomials", test_supported_polynomials),
     Case("Test partial CRC", test_partial_crc),
     Case("Test SD CRC polynomials", test_sd_crc),
-    Case("Test not supported polynomials", test_any_polynomial)
+    Case("Test not supported polynomials", test_any_polynomial),
+    Case("Test sliced CRC32", test_sliced_crc),
+    Case("Test CRC32 throughput", test_crc_throughput)
 };
 
 utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
@@ -0,0 +1,132 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+#include "mbed.h"
+
+#if !DEVICE_SERIAL_ASYNCH
+#error [NOT_SUPPORTED] test requires SERIAL_ASYNCH
+#endif
+
+#if !MBED_CONF_DRIVERS_UART_SERIAL_TX_ASYNCH_SIZE || !MBED_CONF_PLATFORM_STDIO_BUFFERED_SERIAL
+#error [NOT_SUPPORTED] test requires drivers.uart-serial-tx-asynch-size, run with --test-config tools/test_configs/UARTSerialTxAsynch.json
+#endif
+
+using namespace utest::v1;
+
+/* The console is a UARTSerial transmitting with the asynchronous serial API,
+ * the greentea output of this test goes through it as well.
+ */
+
+#define TEST_LINE_SIZE      64
+/* Bytes the hardware may still hold when the transfer reports completion */
+#define TEST_FIFO_SIZE      8
+
+static void fill_line(char *line, int index)
+{
+    for (int i = 0; i < TEST_LINE_SIZE - 1; i++) {
+        line[i] = 'a' + (index + i) % 26;
+    }
+    line[TEST_LINE_SIZE - 1] = '\n';
+}
+
+/* Writes lines to the console and waits for them to be sent, sync() may not
+ * return before they had the time to go out on the wire.
+ */
+static void write_lines(int lines)
+{
+    char line[TEST_LINE_SIZE];
+    Timer timer;
+
+    TEST_ASSERT_EQUAL(0, fsync(STDOUT_FILENO));
+    timer.start();
+    for (int i = 0; i < lines; i++) {
+        fill_line(line, i);
+        TEST_ASSERT_EQUAL(TEST_LINE_SIZE, write(STDOUT_FILENO, line, TEST_LINE_SIZE));
+    }
+    TEST_ASSERT_EQUAL(0, fsync(STDOUT_FILENO));
+    timer.stop();
+
+    // At least 8 bits per byte
+    uint64_t bits = (uint64_t)(lines * TEST_LINE_SIZE - TEST_FIFO_SIZE) * 8;
+    TEST_ASSERT(timer.read_high_resolution_us() >= bits * 1000000 / MBED_CONF_PLATFORM_STDIO_BAUD_RATE);
+}
+
+/* One line, less than a TX buffer, sent in a couple of blocks */
+void test_uart_serial_tx_asynch_line()
+{
+    write_lines(1);
+}
+
+/* Writes wait for blocks to be sent when the TX buffer fills up */
+void test_uart_serial_tx_asynch_full()
+{
+    write_lines(4 * MBED_CONF_DRIVERS_UART_SERIAL_TXBUF_SIZE / TEST_LINE_SIZE);
+}
+
+/* Writes and syncs from several threads all get through */
+#if MBED_CONF_RTOS_PRESENT
+static void write_thread(int *written)
+{
+    char line[TEST_LINE_SIZE];
+    for (int i = 0; i < 2 * MBED_CONF_DRIVERS_UART_SERIAL_TXBUF_SIZE / TEST_LINE_SIZE; i++) {
+        fill_line(line, i);
+        *written += write(STDOUT_FILENO, line, TEST_LINE_SIZE);
+    }
+    fsync(STDOUT_FILENO);
+}
+
+void test_uart_serial_tx_asynch_threads()
+{
+    int written1 = 0;
+    int written2 = 0;
+    Thread thread1(osPriorityNormal, 1024);
+    Thread thread2(osPriorityNormal, 1024);
+    TEST_ASSERT_EQUAL(osOK, thread1.start(callback(write_thread, &written1)));
+    TEST_ASSERT_EQUAL(osOK, thread2.start(callback(write_thread, &written2)));
+    thread1.join();
+    thread2.join();
+    TEST_ASSERT_EQUAL(2 * MBED_CONF_DRIVERS_UART_SERIAL_TXBUF_SIZE, written1);
+    TEST_ASSERT_EQUAL(2 * MBED_CONF_DRIVERS_UART_SERIAL_TXBUF_SIZE, written2);
+
+    // Everything from both threads was sent
+    write_lines(1);
+}
+#endif
+
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(30, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("UARTSerial asynch TX line", test_uart_serial_tx_asynch_line),
+    Case("UARTSerial asynch TX full buffer", test_uart_serial_tx_asynch_full),
+#if MBED_CONF_RTOS_PRESENT
+    Case("UARTSerial asynch TX threads", test_uart_serial_tx_asynch_threads),
+#endif
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
@@ -25,6 +25,10 @@
 #include "mbed.h"
 #include "ticker_api.h"
 
+#if MBED_CONF_PLATFORM_TICKER_QUEUE_HEAP
+#error [NOT_SUPPORTED] test inspects the sorted list of events
+#endif
+
 using namespace utest::v1;
 
 #define MBED_ARRAY_SIZE(array) (sizeof(array)/sizeof(array[0]))
@@ -0,0 +1,168 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+
+#include "mbed.h"
+#include "ticker_api.h"
+
+using namespace utest::v1;
+
+#define TEST_READS          10000
+// Keeps the exact conversion ticks * 1000000 within 64 bits
+#define TEST_MAX_TICKS      15000000000000ULL
+
+/* Fake ticker with a configurable frequency and width, its counter only
+ * moves when the test sets it
+ */
+static ticker_info_t stub_info;
+static timestamp_t stub_time;
+static timestamp_t stub_interrupt;
+
+static void stub_init()
+{
+}
+
+static uint32_t stub_read()
+{
+    return stub_time;
+}
+
+static void stub_disable_interrupt()
+{
+}
+
+static void stub_clear_interrupt()
+{
+}
+
+static void stub_set_interrupt(timestamp_t timestamp)
+{
+    stub_interrupt = timestamp;
+}
+
+static void stub_fire_interrupt()
+{
+    stub_interrupt = stub_time;
+}
+
+static const ticker_info_t *stub_get_info()
+{
+    return &stub_info;
+}
+
+static const ticker_interface_t stub_interface = {
+    stub_init,
+    stub_read,
+    stub_disable_interrupt,
+    stub_clear_interrupt,
+    stub_set_interrupt,
+    stub_fire_interrupt,
+    stub_get_info
+};
+
+static ticker_event_queue_t stub_queue;
+static const ticker_data_t stub_ticker = { &stub_interface, &stub_queue };
+
+static uint32_t random_state;
+
+static uint32_t random_next()
+{
+    random_state = random_state * 1664525 + 1013904223;
+    return random_state;
+}
+
+/* Runs the fake ticker of the given frequency and width through
+ * TEST_READS random steps. The time read is compared to the
+ * exact conversion of the ticks elapsed, and the interrupt scheduled for a
+ * random delay to the exact conversion of that delay.
+ */
+static void test_conversion(uint32_t frequency, uint32_t bits)
+{
+    const uint32_t mask = bits == 32 ? 0xFFFFFFFF : (1UL << bits) - 1;
+    const uint32_t max_delta = 0x7 << (bits - 4);
+    const uint64_t max_delta_us = ((uint64_t)max_delta * 1000000 + frequency - 1) / frequency;
+
+    memset(&stub_queue, 0, sizeof(stub_queue));
+    stub_info.frequency = frequency;
+    stub_info.bits = bits;
+    stub_time = 0;
+    random_state = frequency ^ bits;
+
+    uint64_t ticks = 0;
+    ticker_event_t event = { 0 };
+    ticker_read_us(&stub_ticker);
+
+    for (int i = 0; i < TEST_READS && ticks < TEST_MAX_TICKS; i++) {
+        // Steps within the range the ticker can measure between reads
+        uint32_t step = random_next() % max_delta;
+        ticks += step;
+        stub_time = (stub_time + step) & mask;
+
+        us_timestamp_t expected = ticks * 1000000 / frequency;
+        us_timestamp_t now = ticker_read_us(&stub_ticker);
+        TEST_ASSERT_EQUAL_UINT64(expected, now);
+
+        uint64_t delay = ((uint64_t)random_next() << 32 | random_next()) % max_delta_us + 1;
+        uint64_t delta = delay * frequency / 1000000;
+        if (delta > max_delta) {
+            delta = max_delta;
+        }
+        ticker_insert_event_us(&stub_ticker, &event, now + delay, 0);
+        TEST_ASSERT_EQUAL_UINT32((stub_time + delta) & mask, stub_interrupt);
+        ticker_remove_event(&stub_ticker, &event);
+    }
+}
+
+template<uint32_t Frequency, uint32_t Bits>
+void test_conversion()
+{
+    test_conversion(Frequency, Bits);
+}
+
+utest::v1::status_t greentea_failure_handler(const Case *const source, const failure_t reason)
+{
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("1 Hz, 32 bits", test_conversion<1, 32>, greentea_failure_handler),
+    Case("1 kHz, 16 bits", test_conversion<1000, 16>, greentea_failure_handler),
+    Case("32768 Hz, 32 bits", test_conversion<32768, 32>, greentea_failure_handler),
+    Case("32768 Hz, 16 bits", test_conversion<32768, 16>, greentea_failure_handler),
+    Case("250 kHz, 24 bits", test_conversion<250000, 24>, greentea_failure_handler),
+    Case("1 MHz, 32 bits", test_conversion<1000000, 32>, greentea_failure_handler),
+    Case("3 MHz, 32 bits", test_conversion<3000000, 32>, greentea_failure_handler),
+    Case("16 MHz, 16 bits", test_conversion<16000000, 16>, greentea_failure_handler),
+    Case("48 MHz, 32 bits", test_conversion<48000000, 32>, greentea_failure_handler),
+    Case("2^32 - 1 Hz, 32 bits", test_conversion<0xFFFFFFFF, 32>, greentea_failure_handler),
+};
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(120, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+int main()
+{
+    return Harness::run(specification);
+}
@@ -0,0 +1,219 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+
+#include "mbed.h"
+#include "ticker_api.h"
+
+using namespace utest::v1;
+
+/* Covers the sorted list by default, run with --test-config
+ * tools/test_configs/TickerQueueHeap.json for the pairing heap
+ */
+#define MAX_EVENTS          128
+#define TEST_ROUNDS         4
+
+/* Fake ticker, its time only moves when the test sets it */
+static timestamp_t stub_time;
+static timestamp_t stub_interrupt;
+
+static void stub_init()
+{
+}
+
+static uint32_t stub_read()
+{
+    return stub_time;
+}
+
+static void stub_disable_interrupt()
+{
+}
+
+static void stub_clear_interrupt()
+{
+}
+
+static void stub_set_interrupt(timestamp_t timestamp)
+{
+    stub_interrupt = timestamp;
+}
+
+static void stub_fire_interrupt()
+{
+    stub_interrupt = stub_time;
+}
+
+static const ticker_info_t *stub_get_info()
+{
+    static const ticker_info_t info = { 1000000, 32 };
+    return &info;
+}
+
+static const ticker_interface_t stub_interface = {
+    stub_init,
+    stub_read,
+    stub_disable_interrupt,
+    stub_clear_interrupt,
+    stub_set_interrupt,
+    stub_fire_interrupt,
+    stub_get_info
+};
+
+static ticker_event_queue_t stub_queue;
+static const ticker_data_t stub_ticker = { &stub_interface, &stub_queue };
+
+static ticker_event_t test_events[MAX_EVENTS];
+static uint32_t fired[MAX_EVENTS];
+static uint32_t fired_count;
+
+static void stub_handler(uint32_t id)
+{
+    fired[fired_count++] = id;
+}
+
+static void reset_stub_ticker()
+{
+    memset(&stub_queue, 0, sizeof(stub_queue));
+    memset(test_events, 0, sizeof(test_events));
+    stub_time = 0;
+    fired_count = 0;
+    ticker_set_handler(&stub_ticker, stub_handler);
+}
+
+/* Pseudo random timestamps, with some repeats */
+static us_timestamp_t event_time(uint32_t i)
+{
+    return 1000 + (i * 7919) % 4093;
+}
+
+/* Test ticker queue - events fire in timestamp order.
+ *
+ * Given is a ticker with a fake interface.
+ * When events are inserted in random order, and some of them removed or rescheduled.
+ * Then the interrupt is scheduled for the earliest event, and the events
+ * still queued fire in timestamp order.
+ *
+ */
+void test_queue_order()
+{
+    reset_stub_ticker();
+
+    for (uint32_t i = 0; i < MAX_EVENTS; i++) {
+        ticker_insert_event_us(&stub_ticker, &test_events[i], event_time(i), i);
+    }
+    // Remove every third event, reschedule every fifth
+    for (uint32_t i = 0; i < MAX_EVENTS; i += 3) {
+        ticker_remove_event(&stub_ticker, &test_events[i]);
+    }
+    for (uint32_t i = 1; i < MAX_EVENTS; i += 5) {
+        ticker_remove_event(&stub_ticker, &test_events[i]);
+        ticker_insert_event_us(&stub_ticker, &test_events[i], event_time(i) / 2, i);
+    }
+    // Removing an event which isn't queued does nothing
+    ticker_remove_event(&stub_ticker, &test_events[0]);
+
+    uint32_t expected = 0;
+    us_timestamp_t last = 0;
+    for (uint32_t i = 0; i < MAX_EVENTS; i++) {
+        expected += (i % 3) != 0 || (i % 5) == 1;
+    }
+
+    while (fired_count < expected) {
+        timestamp_t next;
+        TEST_ASSERT_EQUAL(1, ticker_get_next_timestamp(&stub_ticker, &next));
+        TEST_ASSERT_EQUAL(next, stub_interrupt);
+        TEST_ASSERT(next >= last);
+        last = next;
+
+        uint32_t before = fired_count;
+        stub_time = next;
+        ticker_irq_handler(&stub_ticker);
+        TEST_ASSERT(fired_count > before);
+        for (uint32_t i = before; i < fired_count; i++) {
+            TEST_ASSERT_EQUAL(next, test_events[fired[i]].timestamp);
+        }
+    }
+
+    timestamp_t next;
+    TEST_ASSERT_EQUAL(0, ticker_get_next_timestamp(&stub_ticker, &next));
+}
+
+/* Test ticker queue - worst case critical section length.
+ *
+ * Given is a ticker with a fake interface.
+ * When increasing numbers of events are queued.
+ * Then the longest insert and remove, which run entirely in a critical
+ * section, are reported for each number of events.
+ *
+ */
+void test_queue_critical_section_length()
+{
+    Timer timer;
+    timer.start();
+
+    for (uint32_t count = 8; count <= MAX_EVENTS; count *= 2) {
+        int insert_max = 0;
+        int remove_max = 0;
+
+        for (uint32_t round = 0; round < TEST_ROUNDS; round++) {
+            reset_stub_ticker();
+            for (uint32_t i = 0; i < count; i++) {
+                // Later events at the back is the worst case of a sorted list
+                int start = timer.read_us();
+                ticker_insert_event_us(&stub_ticker, &test_events[i], 1000 + i * 10 + round, i);
+                int elapsed = timer.read_us() - start;
+                insert_max = elapsed > insert_max ? elapsed : insert_max;
+            }
+            for (uint32_t i = count; i > 0; i--) {
+                int start = timer.read_us();
+                ticker_remove_event(&stub_ticker, &test_events[i - 1]);
+                int elapsed = timer.read_us() - start;
+                remove_max = elapsed > remove_max ? elapsed : remove_max;
+            }
+        }
+
+        printf("%3lu events: insert %d us, remove %d us worst case\r\n",
+               (unsigned long)count, insert_max, remove_max);
+    }
+}
+
+utest::v1::status_t greentea_failure_handler(const Case *const source, const failure_t reason)
+{
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("Events fire in timestamp order", test_queue_order, greentea_failure_handler),
+    Case("Worst case critical section length", test_queue_critical_section_length, greentea_failure_handler),
+};
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(30, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+int main()
+{
+    return Harness::run(specification);
+}
@@ -0,0 +1,173 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+#include "mbed.h"
+#include <errno.h>
+
+#if !defined(MBED_CONF_RTOS_PRESENT)
+#error [NOT_SUPPORTED] test not supported
+#endif
+
+using namespace utest::v1;
+
+#define TEST_THREADS        4
+#define TEST_STACK_SIZE     768
+#define TEST_ITERATIONS     500
+#define TEST_HELD           3
+
+/* FileHandle remembering the last value written, closed once */
+class TestHandle : public FileHandle {
+public:
+    TestHandle() : value(-1), closed(false) {}
+
+    virtual ssize_t read(void *buffer, size_t size)
+    {
+        return 0;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t size)
+    {
+        memcpy(&value, buffer, sizeof(value));
+        return size;
+    }
+
+    virtual off_t seek(off_t offset, int whence)
+    {
+        return 0;
+    }
+
+    virtual int close()
+    {
+        TEST_ASSERT_FALSE(closed);
+        closed = true;
+        return 0;
+    }
+
+    int value;
+    bool closed;
+};
+
+/* Descriptors are the lowest free ones, up to the configured maximum */
+void test_fd_table_limits()
+{
+    static TestHandle handles[MBED_CONF_PLATFORM_FILEHANDLE_MAX];
+    int fds[MBED_CONF_PLATFORM_FILEHANDLE_MAX];
+    int count = 0;
+
+    for (int i = 0; i < MBED_CONF_PLATFORM_FILEHANDLE_MAX; i++) {
+        fds[i] = bind_to_fd(&handles[i]);
+        if (fds[i] < 0) {
+            TEST_ASSERT_EQUAL(EMFILE, errno);
+            break;
+        }
+        if (i > 0) {
+            TEST_ASSERT_EQUAL(fds[i - 1] + 1, fds[i]);
+        }
+        count++;
+    }
+    TEST_ASSERT(count > 0);
+    TEST_ASSERT_EQUAL(MBED_CONF_PLATFORM_FILEHANDLE_MAX - 1, fds[count - 1]);
+
+    int fd = bind_to_fd(&handles[0]);
+    TEST_ASSERT_EQUAL(-1, fd);
+    TEST_ASSERT_EQUAL(EMFILE, errno);
+
+    // A closed descriptor is the next one handed out
+    int middle = count / 2;
+    TEST_ASSERT_EQUAL(0, close(fds[middle]));
+    TEST_ASSERT_TRUE(handles[middle].closed);
+    handles[middle].closed = false;
+    TEST_ASSERT_EQUAL(fds[middle], bind_to_fd(&handles[middle]));
+
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(sizeof(i), write(fds[i], &i, sizeof(i)));
+        TEST_ASSERT_EQUAL(i, handles[i].value);
+        TEST_ASSERT_EQUAL(0, close(fds[i]));
+    }
+
+    TEST_ASSERT_EQUAL(-1, close(fds[0]));
+    TEST_ASSERT_EQUAL(EBADF, errno);
+}
+
+static void bind_and_close()
+{
+    TestHandle handles[TEST_HELD];
+    int fds[TEST_HELD];
+
+    for (int i = 0; i < TEST_ITERATIONS; i++) {
+        for (int j = 0; j < TEST_HELD; j++) {
+            handles[j].closed = false;
+            fds[j] = bind_to_fd(&handles[j]);
+            TEST_ASSERT(fds[j] >= 3);
+        }
+
+        // Each descriptor reaches its own handle while the others change
+        for (int j = 0; j < TEST_HELD; j++) {
+            int value = i * TEST_HELD + j;
+            TEST_ASSERT_EQUAL(sizeof(value), write(fds[j], &value, sizeof(value)));
+            TEST_ASSERT_EQUAL(value, handles[j].value);
+        }
+
+        for (int j = 0; j < TEST_HELD; j++) {
+            TEST_ASSERT_EQUAL(0, close(fds[j]));
+            TEST_ASSERT_TRUE(handles[j].closed);
+        }
+    }
+}
+
+/* Threads binding and closing descriptors at the same time */
+void test_fd_table_concurrent()
+{
+    Thread *threads[TEST_THREADS];
+
+    for (int i = 0; i < TEST_THREADS; i++) {
+        threads[i] = new Thread(osPriorityNormal, TEST_STACK_SIZE);
+        TEST_ASSERT_EQUAL(osOK, threads[i]->start(bind_and_close));
+    }
+
+    for (int i = 0; i < TEST_THREADS; i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    // Every descriptor was given back
+    TestHandle handle;
+    int fd = bind_to_fd(&handle);
+    TEST_ASSERT_EQUAL(3, fd);
+    TEST_ASSERT_EQUAL(0, close(fd));
+}
+
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("File descriptor table limits", test_fd_table_limits),
+    Case("File descriptor table concurrent bind and close", test_fd_table_concurrent),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
@@ -0,0 +1,152 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+#include "mbed.h"
+
+#if !defined(MBED_CONF_RTOS_PRESENT)
+#error [NOT_SUPPORTED] test not supported
+#endif
+
+using namespace utest::v1;
+
+#define TEST_WAKEUPS        50
+#define TEST_DELAY_US       3300
+#define TEST_TIMEOUT_MS     50
+
+/* FileHandle becoming readable from an interrupt */
+class EventHandle : public FileHandle {
+public:
+    EventHandle(bool wakes) : events(0), signalled(0), wakes(wakes) {}
+
+    virtual ssize_t read(void *buffer, size_t size)
+    {
+        return -EAGAIN;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t size)
+    {
+        return -EAGAIN;
+    }
+
+    virtual off_t seek(off_t offset, int whence)
+    {
+        return -ESPIPE;
+    }
+
+    virtual int close()
+    {
+        return 0;
+    }
+
+    virtual short poll(short mask) const
+    {
+        return this->events;
+    }
+
+    virtual bool wakes_poll() const
+    {
+        return wakes;
+    }
+
+    void signal()
+    {
+        signalled = timer.read_us();
+        events = POLLIN;
+        poll_change(this);
+    }
+
+    volatile short events;
+    volatile int signalled;
+    bool wakes;
+    Timer timer;
+};
+
+/* Returns the average time from an interrupt making the handle readable
+ * to poll() returning it
+ */
+static int poll_latency(bool wakes)
+{
+    EventHandle handle(wakes);
+    EventHandle idle(true);
+    Timeout timeout;
+    int total = 0;
+
+    handle.timer.start();
+    for (int i = 0; i < TEST_WAKEUPS; i++) {
+        handle.events = 0;
+        // Vary the delay so it doesn't line up with the tick
+        timeout.attach_us(callback(&handle, &EventHandle::signal), TEST_DELAY_US + 97 * i);
+
+        pollfh fhs[2] = { { &idle, POLLIN, 0 }, { &handle, POLLIN, 0 } };
+        TEST_ASSERT_EQUAL(1, poll(fhs, 2, -1));
+        int woken = handle.timer.read_us();
+        TEST_ASSERT_EQUAL(0, fhs[0].revents);
+        TEST_ASSERT_EQUAL(POLLIN, fhs[1].revents);
+        total += woken - handle.signalled;
+    }
+
+    return total / TEST_WAKEUPS;
+}
+
+/* Handles calling poll_change() wake poll() up at once, rather than at the next scan */
+void test_poll_wakeup_latency()
+{
+    int scanned = poll_latency(false);
+    int woken = poll_latency(true);
+
+    printf("poll wakeup latency: %d us scanned, %d us woken\r\n", scanned, woken);
+    TEST_ASSERT(woken < 500);
+    TEST_ASSERT(woken <= scanned);
+}
+
+/* poll() still times out when nothing happens */
+void test_poll_timeout()
+{
+    EventHandle handle(true);
+    pollfh fhs[1] = { { &handle, POLLIN, 0 } };
+    Timer timer;
+
+    TEST_ASSERT_EQUAL(0, poll(fhs, 1, 0));
+
+    timer.start();
+    TEST_ASSERT_EQUAL(0, poll(fhs, 1, TEST_TIMEOUT_MS));
+    int elapsed = timer.read_ms();
+    TEST_ASSERT_EQUAL(0, fhs[0].revents);
+    TEST_ASSERT(elapsed >= TEST_TIMEOUT_MS);
+    TEST_ASSERT(elapsed <= TEST_TIMEOUT_MS + 5);
+}
+
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("poll wakeup latency", test_poll_wakeup_latency),
+    Case("poll timeout", test_poll_timeout),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
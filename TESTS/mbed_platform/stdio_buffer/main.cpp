@@ -0,0 +1,280 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+#include "mbed.h"
+
+#if !MBED_CONF_PLATFORM_STDIO_CONVERT_TTY_NEWLINES
+#error [NOT_SUPPORTED] test requires platform.stdio-convert-tty-newlines, run with --test-config tools/test_configs/StdioConvertTtyNewlines.json
+#endif
+
+using namespace utest::v1;
+
+#define TEST_LINES          16
+#define TEST_CAPTURE_SIZE   1024
+#define TEST_LONG_LINE      200
+#define TEST_LONG_RUN       512
+
+/* Terminal FileHandle capturing its output and counting the writes */
+class CaptureHandle : public FileHandle {
+public:
+    CaptureHandle() : writes(0), length(0), limit(TEST_CAPTURE_SIZE), budget(TEST_CAPTURE_SIZE) {}
+
+    virtual ssize_t read(void *buffer, size_t size)
+    {
+        return 0;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t size)
+    {
+        writes++;
+        if (budget == 0) {
+            return -EAGAIN;
+        }
+        if (size > limit) {
+            size = limit;
+        }
+        if (size > budget) {
+            size = budget;
+        }
+        TEST_ASSERT(length + size <= sizeof(data));
+        memcpy(data + length, buffer, size);
+        length += size;
+        budget -= size;
+        return size;
+    }
+
+    virtual off_t seek(off_t offset, int whence)
+    {
+        return -ESPIPE;
+    }
+
+    virtual int close()
+    {
+        return 0;
+    }
+
+    virtual int isatty()
+    {
+        return true;
+    }
+
+    void reset()
+    {
+        writes = 0;
+        length = 0;
+        budget = TEST_CAPTURE_SIZE;
+    }
+
+    unsigned writes;
+    size_t length;
+    size_t limit;
+    size_t budget;
+    char data[TEST_CAPTURE_SIZE];
+};
+
+static void check_lines(CaptureHandle &handle, int lines)
+{
+    char expected[32];
+    size_t offset = 0;
+
+    for (int i = 0; i < lines; i++) {
+        int size = sprintf(expected, "line %d: %s\r\n", i, "value");
+        TEST_ASSERT(offset + size <= handle.length);
+        TEST_ASSERT_EQUAL_MEMORY(expected, handle.data + offset, size);
+        offset += size;
+    }
+    TEST_ASSERT_EQUAL(offset, handle.length);
+}
+
+/* Newlines are converted in bulk, each line reaches the FileHandle in one write
+ * rather than being split around the inserted '\r'
+ */
+void test_stdio_buffer_writes()
+{
+    CaptureHandle handle;
+    FILE *file = fdopen(&handle, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    // Unbuffered, so the C library passes each piece of the format on
+    TEST_ASSERT_EQUAL(0, setvbuf(file, NULL, _IONBF, 0));
+
+    for (int i = 0; i < TEST_LINES; i++) {
+        TEST_ASSERT(fprintf(file, "line %d: %s\n", i, "value") > 0);
+    }
+    TEST_ASSERT_EQUAL(0, fsync(fileno(file)));
+    check_lines(handle, TEST_LINES);
+
+    printf("%u writes for %d lines, %.2f per fprintf\r\n",
+           handle.writes, TEST_LINES, (float)handle.writes / TEST_LINES);
+
+    // How the C library splits up fprintf varies, an unbuffered fwrite of a
+    // line is passed on whole
+    handle.reset();
+    for (int i = 0; i < TEST_LINES; i++) {
+        char line[32];
+        int size = sprintf(line, "line %d: %s\n", i, "value");
+        TEST_ASSERT_EQUAL(size, fwrite(line, 1, size, file));
+    }
+    TEST_ASSERT_EQUAL(0, fsync(fileno(file)));
+    check_lines(handle, TEST_LINES);
+#if MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY == 2
+    TEST_ASSERT(handle.writes < TEST_LINES);
+#else
+    TEST_ASSERT_EQUAL(TEST_LINES, handle.writes);
+#endif
+
+    TEST_ASSERT_EQUAL(0, fclose(file));
+}
+
+/* Output the FileHandle only partly takes is written by later flushes */
+void test_stdio_buffer_partial_writes()
+{
+    CaptureHandle handle;
+    handle.limit = 5;
+    FILE *file = fdopen(&handle, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(0, setvbuf(file, NULL, _IONBF, 0));
+
+    for (int i = 0; i < TEST_LINES; i++) {
+        TEST_ASSERT(fprintf(file, "line %d: %s\n", i, "value") > 0);
+    }
+    TEST_ASSERT_EQUAL(0, fsync(fileno(file)));
+    check_lines(handle, TEST_LINES);
+
+    TEST_ASSERT_EQUAL(0, fclose(file));
+}
+
+/* Lines longer than the stdio buffer are written whole, not in pieces */
+void test_stdio_buffer_long_lines()
+{
+    CaptureHandle handle;
+    FILE *file = fdopen(&handle, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(0, setvbuf(file, NULL, _IONBF, 0));
+
+    static char output[TEST_LONG_RUN];
+    for (int i = 0; i < TEST_LONG_RUN; i++) {
+        output[i] = 'a' + i % 26;
+    }
+
+    // A long line, passed on along with its "\r\n"
+    output[TEST_LONG_LINE - 1] = '\n';
+    TEST_ASSERT_EQUAL(TEST_LONG_LINE, fwrite(output, 1, TEST_LONG_LINE, file));
+    TEST_ASSERT_EQUAL(0, fsync(fileno(file)));
+    TEST_ASSERT_EQUAL(TEST_LONG_LINE + 1, handle.length);
+    TEST_ASSERT_EQUAL_MEMORY(output, handle.data, TEST_LONG_LINE - 1);
+    TEST_ASSERT_EQUAL_MEMORY("\r\n", handle.data + TEST_LONG_LINE - 1, 2);
+#if MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY == 0
+    TEST_ASSERT(handle.writes <= 2);
+#endif
+
+    // Output with no newline at all
+    handle.reset();
+    output[TEST_LONG_LINE - 1] = 'x';
+    TEST_ASSERT_EQUAL(TEST_LONG_RUN, fwrite(output, 1, TEST_LONG_RUN, file));
+    TEST_ASSERT_EQUAL(0, fsync(fileno(file)));
+    TEST_ASSERT_EQUAL(TEST_LONG_RUN, handle.length);
+    TEST_ASSERT_EQUAL_MEMORY(output, handle.data, TEST_LONG_RUN);
+#if MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY == 0
+    TEST_ASSERT_EQUAL(1, handle.writes);
+#endif
+
+    // The same in pieces, when the FileHandle only takes a few bytes at a time
+    handle.reset();
+    handle.limit = 5;
+    output[TEST_LONG_LINE - 1] = '\n';
+    TEST_ASSERT_EQUAL(TEST_LONG_LINE, fwrite(output, 1, TEST_LONG_LINE, file));
+    TEST_ASSERT_EQUAL(0, fsync(fileno(file)));
+    TEST_ASSERT_EQUAL(TEST_LONG_LINE + 1, handle.length);
+    TEST_ASSERT_EQUAL_MEMORY(output, handle.data, TEST_LONG_LINE - 1);
+    TEST_ASSERT_EQUAL_MEMORY("\r\n", handle.data + TEST_LONG_LINE - 1, 2);
+
+    TEST_ASSERT_EQUAL(0, fclose(file));
+}
+
+/* Output the FileHandle fails to take is written again, and only once */
+void test_stdio_buffer_write_errors()
+{
+    CaptureHandle handle;
+    FILE *file = fdopen(&handle, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(0, setvbuf(file, NULL, _IONBF, 0));
+
+    // Fails after the '\r' inserted before the first '\n'
+    handle.budget = 3;
+    const char output[] = "ab\ncd\n";
+    size_t written = fwrite(output, 1, sizeof(output) - 1, file);
+#if MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY == 0
+    // Only the bytes which reached the FileHandle are reported
+    TEST_ASSERT_EQUAL(2, written);
+#endif
+    TEST_ASSERT(written > 0);
+
+    handle.budget = TEST_CAPTURE_SIZE;
+    clearerr(file);
+    written += fwrite(output + written, 1, sizeof(output) - 1 - written, file);
+    TEST_ASSERT_EQUAL(sizeof(output) - 1, written);
+    TEST_ASSERT_EQUAL(0, fsync(fileno(file)));
+
+    const char expected[] = "ab\r\ncd\r\n";
+    TEST_ASSERT_EQUAL(sizeof(expected) - 1, handle.length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, handle.data, sizeof(expected) - 1);
+
+    TEST_ASSERT_EQUAL(0, fclose(file));
+}
+
+/* Existing "\r\n" pairs are left alone, also across separate writes */
+void test_stdio_buffer_crlf()
+{
+    CaptureHandle handle;
+    FILE *file = fdopen(&handle, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(0, setvbuf(file, NULL, _IONBF, 0));
+
+    TEST_ASSERT_EQUAL(3, fprintf(file, "a\r\n"));
+    TEST_ASSERT_EQUAL(2, fprintf(file, "b\r"));
+    TEST_ASSERT_EQUAL(3, fprintf(file, "\n\nc"));
+    // Closing writes out anything held back
+    TEST_ASSERT_EQUAL(0, fclose(file));
+
+    const char expected[] = "a\r\nb\r\n\r\nc";
+    TEST_ASSERT_EQUAL(sizeof(expected) - 1, handle.length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, handle.data, sizeof(expected) - 1);
+}
+
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("Console output writes per line", test_stdio_buffer_writes),
+    Case("Console output partial writes", test_stdio_buffer_partial_writes),
+    Case("Console output long lines", test_stdio_buffer_long_lines),
+    Case("Console output write errors", test_stdio_buffer_write_errors),
+    Case("Console output existing CRLF", test_stdio_buffer_crlf),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
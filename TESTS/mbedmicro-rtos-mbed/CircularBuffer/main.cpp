@@ -442,6 +442,55 @@ void test_peek_no_pop()
     }
 }
 
+/* Test circular buffer - push and pop blocks of data.
+ *
+ * Given is a circular buffer with the capacity equal to N (BufferSize).
+ * When blocks of elements are pushed and popped, wrapping around the end of the buffer.
+ * Then only as many elements as fit are pushed, without overwriting entries,
+ * and elements are popped in the order they were pushed.
+ *
+ */
+template<typename T, uint32_t BufferSize>
+void test_push_pop_block()
+{
+    CircularBuffer<T, BufferSize> cb;
+    T src[2 * BufferSize];
+    T dest[2 * BufferSize];
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+
+    for (uint32_t i = 0; i < 2 * BufferSize; i++) {
+        src[i] = i % BufferSize;
+    }
+
+    /* More than fits is truncated to the capacity. */
+    TEST_ASSERT_EQUAL(BufferSize, cb.push(src, 2 * BufferSize));
+    TEST_ASSERT_TRUE(cb.full());
+    TEST_ASSERT_EQUAL(0, cb.push(src, 1));
+    pushed = BufferSize;
+
+    /* Pop and push odd sized blocks so they wrap around. */
+    for (uint32_t round = 0; round < 3 * BufferSize; round++) {
+        uint32_t len = (round % 3) + 1;
+        uint32_t count = cb.pop(dest, len);
+        TEST_ASSERT_EQUAL(len < BufferSize ? len : BufferSize, count);
+        for (uint32_t i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL((T)(popped % BufferSize), dest[i]);
+            popped++;
+        }
+
+        TEST_ASSERT_EQUAL(count, cb.push(src + pushed % BufferSize, count));
+        pushed += count;
+        TEST_ASSERT_TRUE(cb.full());
+    }
+
+    /* Popping more than is stored empties the buffer. */
+    TEST_ASSERT_EQUAL(BufferSize, cb.pop(dest, 2 * BufferSize));
+    TEST_ASSERT_EQUAL((T)(popped % BufferSize), dest[0]);
+    TEST_ASSERT_TRUE(cb.empty());
+    TEST_ASSERT_EQUAL(0, cb.pop(dest, 1));
+}
+
 utest::v1::status_t greentea_failure_handler(const Case *const source, const failure_t reason)
 {
     greentea_case_failure_abort_handler(source, reason);
@@ -486,6 +535,9 @@ Case cases[] = {
          test_input_exceeds_capacity_push_2_pop_1_complex_type<5, unsigned short>, greentea_failure_handler),
 
     Case("peek() return data without popping the element.", test_peek_no_pop, greentea_failure_handler),
+
+    Case("Push and pop blocks(1).", test_push_pop_block<char, 1>, greentea_failure_handler),
+    Case("Push and pop blocks(7).", test_push_pop_block<uint32_t, 7>, greentea_failure_handler),
 };
 
 utest::v1::status_t greentea_test_setup(const size_t number_of_cases)
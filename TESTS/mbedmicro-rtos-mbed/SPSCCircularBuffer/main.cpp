@@ -0,0 +1,186 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+
+#include "mbed.h"
+#include "platform/CircularBuffer.h"
+#include "platform/SPSCCircularBuffer.h"
+
+#if !defined(MBED_CONF_RTOS_PRESENT)
+#error [NOT_SUPPORTED] test not supported
+#endif
+
+using namespace utest::v1;
+
+#define TEST_STACK_SIZE     768
+#define TEST_ELEMENTS       20000
+#define TEST_BLOCK          16
+
+/* Test SPSC circular buffer - fill, drain and wrap around.
+ *
+ * Given is a SPSC circular buffer with the capacity equal to N (BufferSize).
+ * When single elements and blocks are pushed and popped.
+ * Then all N elements can be used, pushing to a full buffer fails without
+ * overwriting, and elements are popped in the order they were pushed.
+ *
+ */
+template<typename T, uint32_t BufferSize>
+void test_push_pop()
+{
+    SPSCCircularBuffer<T, BufferSize> cb;
+    T src[2 * BufferSize];
+    T dest[2 * BufferSize];
+    T data = 0;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+
+    for (uint32_t i = 0; i < 2 * BufferSize; i++) {
+        src[i] = i % BufferSize;
+    }
+
+    TEST_ASSERT_TRUE(cb.empty());
+    TEST_ASSERT_FALSE(cb.pop(data));
+    TEST_ASSERT_FALSE(cb.peek(data));
+
+    for (uint32_t i = 0; i < BufferSize; i++) {
+        TEST_ASSERT_FALSE(cb.full());
+        TEST_ASSERT_TRUE(cb.push(src[i]));
+        TEST_ASSERT_EQUAL(i + 1, cb.size());
+    }
+    pushed = BufferSize;
+    TEST_ASSERT_TRUE(cb.full());
+    TEST_ASSERT_FALSE(cb.push(data));
+    TEST_ASSERT_EQUAL(0, cb.push(src, 1));
+
+    /* Pop and push odd sized blocks so they wrap around. */
+    for (uint32_t round = 0; round < 3 * BufferSize; round++) {
+        uint32_t len = (round % 3) + 1;
+        uint32_t count = cb.pop(dest, len);
+        TEST_ASSERT_EQUAL(len < BufferSize ? len : BufferSize, count);
+        for (uint32_t i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL((T)(popped % BufferSize), dest[i]);
+            popped++;
+        }
+
+        if (count < BufferSize) {
+            TEST_ASSERT_TRUE(cb.peek(data));
+            TEST_ASSERT_EQUAL((T)(popped % BufferSize), data);
+        }
+
+        TEST_ASSERT_EQUAL(count, cb.push(src + pushed % BufferSize, 2 * BufferSize));
+        pushed += count;
+        TEST_ASSERT_TRUE(cb.full());
+    }
+
+    cb.reset();
+    TEST_ASSERT_TRUE(cb.empty());
+    TEST_ASSERT_EQUAL(0, cb.size());
+    TEST_ASSERT_EQUAL(0, cb.pop(dest, 1));
+}
+
+template<typename Buffer>
+static void produce(Buffer *cb)
+{
+    uint32_t src[TEST_BLOCK];
+    uint32_t next = 0;
+
+    while (next < TEST_ELEMENTS) {
+        uint32_t len = TEST_ELEMENTS - next < TEST_BLOCK ? TEST_ELEMENTS - next : TEST_BLOCK;
+        for (uint32_t i = 0; i < len; i++) {
+            src[i] = next + i;
+        }
+        uint32_t count = cb->push(src, len);
+        next += count;
+        if (count == 0) {
+            Thread::yield();
+        }
+    }
+}
+
+/* Returns the time in us to pass TEST_ELEMENTS from a producer thread to
+ * the consumer, checking they arrive in order
+ */
+template<typename Buffer>
+static int transfer(Buffer *cb)
+{
+    Thread producer(osPriorityNormal, TEST_STACK_SIZE);
+    uint32_t dest[TEST_BLOCK];
+    uint32_t expected = 0;
+    Timer timer;
+
+    timer.start();
+    TEST_ASSERT_EQUAL(osOK, producer.start(callback(produce<Buffer>, cb)));
+    while (expected < TEST_ELEMENTS) {
+        uint32_t count = cb->pop(dest, TEST_BLOCK);
+        for (uint32_t i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL(expected, dest[i]);
+            expected++;
+        }
+        if (count == 0) {
+            Thread::yield();
+        }
+    }
+    producer.join();
+    return timer.read_us();
+}
+
+/* Test SPSC circular buffer - producer and consumer threads.
+ *
+ * Given is a SPSC circular buffer and a circular buffer of the same size.
+ * When a producer thread passes elements in blocks to a consumer thread.
+ * Then all elements arrive in order, and the throughputs are reported.
+ *
+ */
+void test_throughput()
+{
+    static SPSCCircularBuffer<uint32_t, 64> spsc;
+    static CircularBuffer<uint32_t, 64> locked;
+
+    int spsc_us = transfer(&spsc);
+    int locked_us = transfer(&locked);
+
+    printf("%d elements: SPSCCircularBuffer %d us, CircularBuffer %d us\r\n",
+           TEST_ELEMENTS, spsc_us, locked_us);
+}
+
+utest::v1::status_t greentea_failure_handler(const Case *const source, const failure_t reason)
+{
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("Push and pop(1).", test_push_pop<char, 1>, greentea_failure_handler),
+    Case("Push and pop(8).", test_push_pop<uint32_t, 8>, greentea_failure_handler),
+    Case("Push and pop(256).", test_push_pop<unsigned char, 256>, greentea_failure_handler),
+    Case("Producer and consumer threads.", test_throughput, greentea_failure_handler),
+};
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(30, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+int main()
+{
+    return Harness::run(specification);
+}
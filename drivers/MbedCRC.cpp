@@ -27,7 +27,8 @@ namespace mbed {
 template<>
 MbedCRC<POLY_32BIT_ANSI, 32>::MbedCRC(uint32_t initial_xor, uint32_t final_xor, bool reflect_data, bool reflect_remainder):
         _initial_value(initial_xor), _final_xor(final_xor), _reflect_data(reflect_data), _reflect_remainder(reflect_remainder),
-        _crc_table((uint32_t *)Table_CRC_32bit_ANSI)
+        _crc_table((reflect_data && reflect_remainder) ? (uint32_t *)Table_CRC_32bit_Rev_ANSI : (uint32_t *)Table_CRC_32bit_ANSI),
+        _sliced_table(reflect_data && reflect_remainder)
 {
     mbed_crc_ctor();
 }
@@ -35,7 +36,7 @@ MbedCRC<POLY_32BIT_ANSI, 32>::MbedCRC(uint32_t initial_xor, uint32_t final_xor,
 template<>
 MbedCRC<POLY_8BIT_CCITT, 8>::MbedCRC(uint32_t initial_xor, uint32_t final_xor, bool reflect_data, bool reflect_remainder):
         _initial_value(initial_xor), _final_xor(final_xor), _reflect_data(reflect_data), _reflect_remainder(reflect_remainder),
-        _crc_table((uint32_t *)Table_CRC_8bit_CCITT)
+        _crc_table((uint32_t *)Table_CRC_8bit_CCITT), _sliced_table(false)
 {
     mbed_crc_ctor();
 }
@@ -43,7 +44,7 @@ MbedCRC<POLY_8BIT_CCITT, 8>::MbedCRC(uint32_t initial_xor, uint32_t final_xor, b
 template<>
 MbedCRC<POLY_7BIT_SD, 7>::MbedCRC(uint32_t initial_xor, uint32_t final_xor, bool reflect_data, bool reflect_remainder):
         _initial_value(initial_xor), _final_xor(final_xor), _reflect_data(reflect_data), _reflect_remainder(reflect_remainder),
-        _crc_table((uint32_t *)Table_CRC_7Bit_SD)
+        _crc_table((uint32_t *)Table_CRC_7Bit_SD), _sliced_table(false)
 {
     mbed_crc_ctor();
 }
@@ -51,14 +52,14 @@ MbedCRC<POLY_7BIT_SD, 7>::MbedCRC(uint32_t initial_xor, uint32_t final_xor, bool
 template<>
 MbedCRC<POLY_16BIT_CCITT, 16>::MbedCRC(uint32_t initial_xor, uint32_t final_xor, bool reflect_data, bool reflect_remainder):
         _initial_value(initial_xor), _final_xor(final_xor), _reflect_data(reflect_data), _reflect_remainder(reflect_remainder),
-        _crc_table((uint32_t *)Table_CRC_16bit_CCITT)
+        _crc_table((uint32_t *)Table_CRC_16bit_CCITT), _sliced_table(false)
 {
 }
 
 template<>
 MbedCRC<POLY_16BIT_IBM, 16>::MbedCRC(uint32_t initial_xor, uint32_t final_xor, bool reflect_data, bool reflect_remainder):
         _initial_value(initial_xor), _final_xor(final_xor), _reflect_data(reflect_data), _reflect_remainder(reflect_remainder),
-        _crc_table((uint32_t *)Table_CRC_16bit_IBM)
+        _crc_table((uint32_t *)Table_CRC_16bit_IBM), _sliced_table(false)
 {
     mbed_crc_ctor();
 }
@@ -66,7 +67,7 @@ MbedCRC<POLY_16BIT_IBM, 16>::MbedCRC(uint32_t initial_xor, uint32_t final_xor, b
 template<>
 MbedCRC<POLY_32BIT_ANSI, 32>::MbedCRC():
     _initial_value(~(0x0)), _final_xor(~(0x0)), _reflect_data(true), _reflect_remainder(true),
-    _crc_table((uint32_t *)Table_CRC_32bit_ANSI)
+    _crc_table((uint32_t *)Table_CRC_32bit_Rev_ANSI), _sliced_table(true)
 {
     mbed_crc_ctor();
 }
@@ -74,7 +75,7 @@ MbedCRC<POLY_32BIT_ANSI, 32>::MbedCRC():
 template<>
 MbedCRC<POLY_16BIT_IBM, 16>::MbedCRC():
     _initial_value(0), _final_xor(0), _reflect_data(true), _reflect_remainder(true),
-    _crc_table((uint32_t *)Table_CRC_16bit_IBM)
+    _crc_table((uint32_t *)Table_CRC_16bit_IBM), _sliced_table(false)
 {
     mbed_crc_ctor();
 }
@@ -82,7 +83,7 @@ MbedCRC<POLY_16BIT_IBM, 16>::MbedCRC():
 template<>
 MbedCRC<POLY_16BIT_CCITT, 16>::MbedCRC():
     _initial_value(~(0x0)), _final_xor(0), _reflect_data(false), _reflect_remainder(false),
-    _crc_table((uint32_t *)Table_CRC_16bit_CCITT)
+    _crc_table((uint32_t *)Table_CRC_16bit_CCITT), _sliced_table(false)
 {
     mbed_crc_ctor();
 }
@@ -90,7 +91,7 @@ MbedCRC<POLY_16BIT_CCITT, 16>::MbedCRC():
 template<>
 MbedCRC<POLY_7BIT_SD, 7>::MbedCRC():
     _initial_value(0), _final_xor(0), _reflect_data(false), _reflect_remainder(false),
-    _crc_table((uint32_t *)Table_CRC_7Bit_SD)
+    _crc_table((uint32_t *)Table_CRC_7Bit_SD), _sliced_table(false)
 {
     mbed_crc_ctor();
 }
@@ -98,7 +99,7 @@ MbedCRC<POLY_7BIT_SD, 7>::MbedCRC():
 template<>
 MbedCRC<POLY_8BIT_CCITT, 8>::MbedCRC():
     _initial_value(0), _final_xor(0), _reflect_data(false), _reflect_remainder(false),
-    _crc_table((uint32_t *)Table_CRC_8bit_CCITT)
+    _crc_table((uint32_t *)Table_CRC_8bit_CCITT), _sliced_table(false)
 {
     mbed_crc_ctor();
 }
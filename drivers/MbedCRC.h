@@ -57,6 +57,9 @@ typedef enum crc_polynomial {
  *  software CRC computation, if ROM tables are not available then CRC is computed runtime
  *  bit by bit for all data input.
  *
+ *  32-bit ANSI CRCs with reflected data and remainder (the common CRC-32) use
+ *  reflected slicing-by-4 ROM tables, processing four bytes per table step.
+ *
  *  @tparam  polynomial CRC polynomial value in hex
  *  @tparam  width CRC polynomial width
  *
@@ -126,7 +129,7 @@ public:
      */
     MbedCRC(uint32_t initial_xor, uint32_t final_xor, bool reflect_data, bool reflect_remainder) :
                     _initial_value(initial_xor), _final_xor(final_xor), _reflect_data(reflect_data),
-                    _reflect_remainder(reflect_remainder), _crc_table(NULL)
+                    _reflect_remainder(reflect_remainder), _crc_table(NULL), _sliced_table(false)
     {
         mbed_crc_ctor();
     }
@@ -181,6 +184,9 @@ public:
         if (NULL == _crc_table) {
             // Compute bitwise CRC
             return bitwise_compute_partial(buffer, size, crc);
+        } else if (_sliced_table) {
+            // Reflected sliced table CRC
+            return sliced_compute_partial(buffer, size, crc);
         } else {
             // Table CRC
             return table_compute_partial(buffer, size, crc);
@@ -200,7 +206,8 @@ public:
     int32_t compute_partial_start(uint32_t *crc)
     {
         MBED_ASSERT(crc != NULL);
-        *crc = _initial_value;
+        // Sliced tables work on the reflected remainder throughout
+        *crc = _sliced_table ? reflect_remainder(_initial_value) : _initial_value;
         return 0;
     }
 
@@ -216,6 +223,10 @@ public:
     {
         MBED_ASSERT(crc != NULL);
         uint32_t p_crc = *crc;
+        if (_sliced_table) {
+            *crc = (p_crc ^ _final_xor) & get_crc_mask();
+            return 0;
+        }
         if ((width < 8) && (NULL == _crc_table)) {
             p_crc = (uint32_t)(p_crc << (8 - width));
         }
@@ -247,6 +258,7 @@ private:
     bool _reflect_data;
     bool _reflect_remainder;
     uint32_t *_crc_table;
+    bool _sliced_table;
 
     /** Get the current CRC data size
      *
@@ -405,6 +417,42 @@ private:
         return 0;
     }
 
+    /** CRC computation using reflected slicing-by-4 ROM tables
+     *
+     * The CRC value is kept reflected, so no per-byte reflection is needed.
+     *
+     * @param  buffer  data buffer
+     * @param  size  size of the data
+     * @param  crc  CRC value is filled in, but the value is not the final
+     * @return  0  on success or a negative error code on failure
+     */
+    int32_t sliced_compute_partial(const void *buffer, crc_data_size_t size, uint32_t *crc) const
+    {
+        MBED_ASSERT(crc != NULL);
+        MBED_ASSERT(buffer != NULL);
+
+        const uint8_t *data = static_cast<const uint8_t *>(buffer);
+        const uint32_t (*crc_table)[MBED_CRC_TABLE_SIZE] =
+            reinterpret_cast<const uint32_t (*)[MBED_CRC_TABLE_SIZE]>(_crc_table);
+        uint32_t p_crc = *crc;
+
+        // Bytes are combined little-endian to match the reflected bit order,
+        // which also makes this safe for unaligned buffers
+        for (; size >= MBED_CRC_SLICES; size -= MBED_CRC_SLICES, data += MBED_CRC_SLICES) {
+            p_crc ^= (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                     ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+            p_crc = crc_table[3][p_crc & 0xFF] ^ crc_table[2][(p_crc >> 8) & 0xFF] ^
+                    crc_table[1][(p_crc >> 16) & 0xFF] ^ crc_table[0][p_crc >> 24];
+        }
+
+        for (; size > 0; size--, data++) {
+            p_crc = crc_table[0][(p_crc ^ *data) & 0xFF] ^ (p_crc >> 8);
+        }
+
+        *crc = p_crc;
+        return 0;
+    }
+
     /** Constructor init called from all specialized cases of constructor
      *  Note: All construtor common code should be in this function.
      */
@@ -33,6 +33,13 @@ UARTSerial::UARTSerial(PinName tx, PinName rx, int baud) :
         _blocking(true),
         _tx_irq_enabled(false),
         _rx_irq_enabled(true),
+#if MBED_CONF_RTOS_PRESENT
+        _rx_sem(0, 1),
+        _tx_sem(0, 1),
+#endif
+#if UART_SERIAL_TX_ASYNCH
+        _tx_asynch_active(false),
+#endif
         _dcd_irq(NULL)
 {
     /* Attatch IRQ routines to the serial device. */
@@ -41,6 +48,11 @@ UARTSerial::UARTSerial(PinName tx, PinName rx, int baud) :
 
 UARTSerial::~UARTSerial()
 {
+#if UART_SERIAL_TX_ASYNCH
+    if (_tx_asynch_active) {
+        SerialBase::abort_write();
+    }
+#endif
     delete _dcd_irq;
 }
 
@@ -109,13 +121,21 @@ int UARTSerial::sync()
 {
     api_lock();
 
-    while (!_txbuf.empty()) {
+    while (!_txbuf.empty()
+#if UART_SERIAL_TX_ASYNCH
+            || _tx_asynch_active
+#endif
+          ) {
         api_unlock();
-        // Doing better than wait would require TxIRQ to also do wake() when becoming empty. Worth it?
-        wait_ms(1);
+        wait_tx();
         api_lock();
     }
 
+#if MBED_CONF_RTOS_PRESENT
+    // Pass the wakeup on to any writer waiting for space
+    _tx_sem.release();
+#endif
+
     api_unlock();
 
     return 0;
@@ -155,27 +175,25 @@ ssize_t UARTSerial::write(const void* buffer, size_t length)
             }
             do {
                 api_unlock();
-                wait_ms(1); // XXX todo - proper wait, WFE for non-rtos ?
+                wait_tx();
                 api_lock();
             } while (_txbuf.full());
         }
 
-        while (data_written < length && !_txbuf.full()) {
-            _txbuf.push(*buf_ptr++);
-            data_written++;
-        }
+        data_written += _txbuf.push(buf_ptr + data_written, length - data_written);
 
         core_util_critical_section_enter();
-        if (!_tx_irq_enabled) {
-            UARTSerial::tx_irq();                // only write to hardware in one place
-            if (!_txbuf.empty()) {
-                SerialBase::attach(callback(this, &UARTSerial::tx_irq), TxIrq);
-                _tx_irq_enabled = true;
-            }
-        }
+        start_tx();
         core_util_critical_section_exit();
     }
 
+#if MBED_CONF_RTOS_PRESENT
+    // Pass the wakeup on to any other writer waiting for space
+    if (!_txbuf.full()) {
+        _tx_sem.release();
+    }
+#endif
+
     api_unlock();
 
     return data_written != 0 ? (ssize_t) data_written : (ssize_t) -EAGAIN;
@@ -199,14 +217,11 @@ ssize_t UARTSerial::read(void* buffer, size_t length)
             return -EAGAIN;
         }
         api_unlock();
-        wait_ms(1);  // XXX todo - proper wait, WFE for non-rtos ?
+        wait_rx();
         api_lock();
     }
 
-    while (data_read < length && !_rxbuf.empty()) {
-        _rxbuf.pop(*ptr++);
-        data_read++;
-    }
+    data_read = _rxbuf.pop(ptr, length);
 
     core_util_critical_section_enter();
     if (!_rx_irq_enabled) {
@@ -218,6 +233,13 @@ ssize_t UARTSerial::read(void* buffer, size_t length)
     }
     core_util_critical_section_exit();
 
+#if MBED_CONF_RTOS_PRESENT
+    // Pass the wakeup on to any other reader waiting for data
+    if (!_rxbuf.empty()) {
+        _rx_sem.release();
+    }
+#endif
+
     api_unlock();
 
     return data_read;
@@ -233,6 +255,7 @@ void UARTSerial::wake()
     if (_sigio_cb) {
         _sigio_cb();
     }
+    poll_change(this);
 }
 
 short UARTSerial::poll(short events) const {
@@ -297,10 +320,62 @@ void UARTSerial::rx_irq(void)
 
     /* Report the File handler that data is ready to be read from the buffer. */
     if (was_empty && !_rxbuf.empty()) {
+#if MBED_CONF_RTOS_PRESENT
+        _rx_sem.release();
+#endif
         wake();
     }
 }
 
+void UARTSerial::start_tx(void)
+{
+#if UART_SERIAL_TX_ASYNCH
+    if (!_tx_asynch_active) {
+        tx_asynch_start();
+    }
+#else
+    if (!_tx_irq_enabled) {
+        UARTSerial::tx_irq();                // only write to hardware in one place
+        if (!_txbuf.empty()) {
+            SerialBase::attach(callback(this, &UARTSerial::tx_irq), TxIrq);
+            _tx_irq_enabled = true;
+        }
+    }
+#endif
+}
+
+#if UART_SERIAL_TX_ASYNCH
+void UARTSerial::tx_asynch_start(void)
+{
+    bool was_full = _txbuf.full();
+    int length = _txbuf.pop(reinterpret_cast<char *>(_tx_asynch_buf), sizeof(_tx_asynch_buf));
+
+    if (length > 0) {
+        _tx_asynch_active = true;
+        if (SerialBase::write(_tx_asynch_buf, length, callback(this, &UARTSerial::tx_asynch_irq),
+                              SERIAL_EVENT_TX_COMPLETE) < 0) {
+            _tx_asynch_active = false;
+        }
+    }
+
+    /* Report the File handler that data can be written, or that all was sent. */
+    if ((was_full && !_txbuf.full()) || !_tx_asynch_active) {
+#if MBED_CONF_RTOS_PRESENT
+        _tx_sem.release();
+#endif
+        if (was_full && !hup()) {
+            wake();
+        }
+    }
+}
+
+void UARTSerial::tx_asynch_irq(int event)
+{
+    _tx_asynch_active = false;
+    tx_asynch_start();
+}
+#endif
+
 // Also called from write to start transfer
 void UARTSerial::tx_irq(void)
 {
@@ -316,14 +391,40 @@ void UARTSerial::tx_irq(void)
     if (_tx_irq_enabled && _txbuf.empty()) {
         SerialBase::attach(NULL, TxIrq);
         _tx_irq_enabled = false;
+#if MBED_CONF_RTOS_PRESENT
+        _tx_sem.release();
+#endif
     }
 
     /* Report the File handler that data can be written to peripheral. */
-    if (was_full && !_txbuf.full() && !hup()) {
-        wake();
+    if (was_full && !_txbuf.full()) {
+#if MBED_CONF_RTOS_PRESENT
+        _tx_sem.release();
+#endif
+        if (!hup()) {
+            wake();
+        }
     }
 }
 
+void UARTSerial::wait_rx(void)
+{
+#if MBED_CONF_RTOS_PRESENT
+    _rx_sem.wait();
+#else
+    wait_ms(1);
+#endif
+}
+
+void UARTSerial::wait_tx(void)
+{
+#if MBED_CONF_RTOS_PRESENT
+    _tx_sem.wait();
+#else
+    wait_ms(1);
+#endif
+}
+
 void UARTSerial::wait_ms(uint32_t millisec)
 {
     /* wait_ms implementation for RTOS spins until exact microseconds - we
@@ -37,6 +37,17 @@
 #define MBED_CONF_DRIVERS_UART_SERIAL_TXBUF_SIZE  256
 #endif
 
+#ifndef MBED_CONF_DRIVERS_UART_SERIAL_TX_ASYNCH_SIZE
+#define MBED_CONF_DRIVERS_UART_SERIAL_TX_ASYNCH_SIZE  0
+#endif
+
+/* Transmit with the asynchronous serial API, a block at a time */
+#define UART_SERIAL_TX_ASYNCH   (DEVICE_SERIAL_ASYNCH && MBED_CONF_DRIVERS_UART_SERIAL_TX_ASYNCH_SIZE > 0)
+
+#if MBED_CONF_RTOS_PRESENT
+#include "rtos/Semaphore.h"
+#endif
+
 namespace mbed {
 
 /** \addtogroup drivers */
@@ -63,6 +74,15 @@ public:
      */
     virtual short poll(short events) const;
 
+    /** Wakes up mbed::poll() when data arrives, buffer space frees up or DCD changes
+     *
+     *  @return true
+     */
+    virtual bool wakes_poll() const
+    {
+        return true;
+    }
+
     /* Resolve ambiguities versus our private SerialBase
      * (for writable, spelling differs, but just in case)
      */
@@ -217,6 +237,15 @@ private:
 
     void wait_ms(uint32_t millisec);
 
+    /** Wait for the RX buffer to become non-empty, or the TX buffer to free up
+     *  space or become empty
+     */
+    void wait_rx(void);
+    void wait_tx(void);
+
+    /** Start transmitting the TX buffer, must be called in a critical section */
+    void start_tx(void);
+
     /** SerialBase lock override */
     virtual void lock(void);
 
@@ -237,6 +266,18 @@ private:
 
     PlatformMutex _mutex;
 
+#if MBED_CONF_RTOS_PRESENT
+    /** Released by the ISRs when the buffers change state */
+    rtos::Semaphore _rx_sem;
+    rtos::Semaphore _tx_sem;
+#endif
+
+#if UART_SERIAL_TX_ASYNCH
+    /** Block of the TX buffer being transmitted */
+    uint8_t _tx_asynch_buf[MBED_CONF_DRIVERS_UART_SERIAL_TX_ASYNCH_SIZE];
+    volatile bool _tx_asynch_active;
+#endif
+
     Callback<void()> _sigio_cb;
 
     bool _blocking;
@@ -259,6 +300,12 @@ private:
     void tx_irq(void);
     void rx_irq(void);
 
+#if UART_SERIAL_TX_ASYNCH
+    /** Completion handler of asynchronous transmits, starts the next block */
+    void tx_asynch_irq(int event);
+    void tx_asynch_start(void);
+#endif
+
     void wake(void);
 
     void dcd_irq(void);
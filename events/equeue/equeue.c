@@ -43,6 +43,98 @@ static inline void equeue_incid(equeue_t *q, struct equeue_event *e) {
 }
 
 
+#ifdef EQUEUE_SCHED_HEAP
+// pairing heap operations, events are ordered by target and then by
+// insertion order so events with equal targets dispatch in post order
+static inline bool equeue_heap_before(struct equeue_event *a,
+        struct equeue_event *b) {
+    int diff = equeue_tickdiff(a->target, b->target);
+    return diff < 0 || (diff == 0 && equeue_tickdiff(a->seq, b->seq) < 0);
+}
+
+// link two heaps, the loser becomes the first child of the winner, the
+// caller is responsible for the next/ref fields of the returned root
+static struct equeue_event *equeue_heap_meld(
+        struct equeue_event *a, struct equeue_event *b) {
+    if (!a) {
+        return b;
+    } else if (!b) {
+        return a;
+    }
+
+    if (equeue_heap_before(b, a)) {
+        struct equeue_event *t = a;
+        a = b;
+        b = t;
+    }
+
+    b->next = a->child;
+    if (b->next) {
+        b->next->ref = &b->next;
+    }
+
+    a->child = b;
+    b->ref = &a->child;
+    return a;
+}
+
+// combine a list of sibling heaps with the standard two-pass pairing
+static struct equeue_event *equeue_heap_merge(struct equeue_event *list) {
+    // meld pairs left to right, collecting the results in reverse
+    struct equeue_event *pairs = 0;
+    while (list) {
+        struct equeue_event *a = list;
+        struct equeue_event *b = a->next;
+        list = b ? b->next : 0;
+
+        a = equeue_heap_meld(a, b);
+        a->next = pairs;
+        pairs = a;
+    }
+
+    // meld the pairs right to left into a single heap
+    struct equeue_event *root = 0;
+    while (pairs) {
+        struct equeue_event *a = pairs;
+        pairs = a->next;
+        root = equeue_heap_meld(root, a);
+    }
+
+    return root;
+}
+
+static void equeue_heap_push(equeue_t *q, struct equeue_event *e) {
+    q->queue = equeue_heap_meld(q->queue, e);
+    q->queue->next = 0;
+    q->queue->ref = &q->queue;
+}
+
+static struct equeue_event *equeue_heap_pop(equeue_t *q) {
+    struct equeue_event *e = q->queue;
+    q->queue = equeue_heap_merge(e->child);
+    if (q->queue) {
+        q->queue->next = 0;
+        q->queue->ref = &q->queue;
+    }
+
+    return e;
+}
+
+static void equeue_heap_remove(equeue_t *q, struct equeue_event *e) {
+    // cut the subtree out of its parent, then merge its children back in
+    *e->ref = e->next;
+    if (e->next) {
+        e->next->ref = e->ref;
+    }
+
+    struct equeue_event *children = equeue_heap_merge(e->child);
+    if (children) {
+        equeue_heap_push(q, children);
+    }
+}
+#endif
+
+
 // equeue lifetime management
 int equeue_create(equeue_t *q, size_t size) {
     // dynamically allocate the specified buffer
@@ -67,13 +159,27 @@ int equeue_create_inplace(equeue_t *q, size_t size, void *buffer) {
     }
 
     q->chunks = 0;
+#if EQUEUE_MEM_BINS > 0
+    for (int i = 0; i < EQUEUE_MEM_BINS; i++) {
+        q->bins[i] = 0;
+    }
+#endif
     q->slab.size = size;
     q->slab.data = buffer;
+    q->usage.used = 0;
+    q->usage.peak = 0;
 
     q->queue = 0;
+    q->inbox = 0;
+    q->batch = 0;
+    q->pool = 0;
+    q->worker = 0;
     q->tick = equeue_tick();
     q->generation = 0;
     q->break_requested = false;
+#ifdef EQUEUE_SCHED_HEAP
+    q->seq = 0;
+#endif
 
     q->background.active = false;
     q->background.update = 0;
@@ -101,6 +207,20 @@ int equeue_create_inplace(equeue_t *q, size_t size, void *buffer) {
 
 void equeue_destroy(equeue_t *q) {
     // call destructors on pending events
+    for (struct equeue_event *e = q->inbox; e; e = e->next) {
+        if (e->dtor) {
+            e->dtor(e + 1);
+        }
+    }
+
+#ifdef EQUEUE_SCHED_HEAP
+    while (q->queue) {
+        struct equeue_event *e = equeue_heap_pop(q);
+        if (e->dtor) {
+            e->dtor(e + 1);
+        }
+    }
+#else
     for (struct equeue_event *es = q->queue; es; es = es->next) {
         for (struct equeue_event *e = q->queue; e; e = e->sibling) {
             if (e->dtor) {
@@ -108,6 +228,7 @@ void equeue_destroy(equeue_t *q) {
             }
         }
     }
+#endif
 
     // notify background timer
     if (q->background.update) {
@@ -122,13 +243,31 @@ void equeue_destroy(equeue_t *q) {
 }
 
 
-// equeue chunk allocation functions
-static struct equeue_event *equeue_mem_alloc(equeue_t *q, size_t size) {
-    // add event overhead
-    size += sizeof(struct equeue_event);
-    size = (size + sizeof(void*)-1) & ~(sizeof(void*)-1);
+// wake up whoever is dispatching the queue
+static void equeue_pool_wake(equeue_pool_t *pool, unsigned worker);
 
-    equeue_mutex_lock(&q->memlock);
+static inline void equeue_notify(equeue_t *q) {
+    if (q->pool) {
+        equeue_pool_wake(q->pool, q->worker);
+    } else {
+        equeue_sema_signal(&q->eventsema);
+    }
+}
+
+
+// equeue chunk allocation functions
+static struct equeue_event *equeue_mem_reuse(equeue_t *q, size_t size) {
+#if EQUEUE_MEM_BINS > 0
+    // check the bins for the smallest chunk that fits
+    size_t bin = (size - sizeof(struct equeue_event)) / sizeof(void*);
+    for (; bin < EQUEUE_MEM_BINS; bin++) {
+        struct equeue_event *e = q->bins[bin];
+        if (e) {
+            q->bins[bin] = e->next;
+            return e;
+        }
+    }
+#endif
 
     // check if a good chunk is available
     for (struct equeue_event **p = &q->chunks; *p; p = &(*p)->next) {
@@ -141,30 +280,59 @@ static struct equeue_event *equeue_mem_alloc(equeue_t *q, size_t size) {
                 *p = e->next;
             }
 
-            equeue_mutex_unlock(&q->memlock);
             return e;
         }
     }
 
+    return 0;
+}
+
+static struct equeue_event *equeue_mem_alloc(equeue_t *q, size_t size) {
+    // add event overhead
+    size += sizeof(struct equeue_event);
+    size = (size + sizeof(void*)-1) & ~(sizeof(void*)-1);
+
+    equeue_mutex_lock(&q->memlock);
+
+    struct equeue_event *e = equeue_mem_reuse(q, size);
+
     // otherwise allocate a new chunk out of the slab
-    if (q->slab.size >= size) {
-        struct equeue_event *e = (struct equeue_event *)q->slab.data;
+    if (!e && q->slab.size >= size) {
+        e = (struct equeue_event *)q->slab.data;
         q->slab.data += size;
         q->slab.size -= size;
         e->size = size;
         e->id = 1;
+    }
 
-        equeue_mutex_unlock(&q->memlock);
-        return e;
+    if (e) {
+        q->usage.used += e->size;
+        if (q->usage.used > q->usage.peak) {
+            q->usage.peak = q->usage.used;
+        }
     }
 
     equeue_mutex_unlock(&q->memlock);
-    return 0;
+    return e;
 }
 
 static void equeue_mem_dealloc(equeue_t *q, struct equeue_event *e) {
     equeue_mutex_lock(&q->memlock);
 
+    q->usage.used -= e->size;
+
+#if EQUEUE_MEM_BINS > 0
+    // small chunks go into the bin for their exact size
+    size_t bin = (e->size - sizeof(struct equeue_event)) / sizeof(void*);
+    if (bin < EQUEUE_MEM_BINS) {
+        e->next = q->bins[bin];
+        q->bins[bin] = e;
+
+        equeue_mutex_unlock(&q->memlock);
+        return;
+    }
+#endif
+
     // stick chunk into list of chunks
     struct equeue_event **p = &q->chunks;
     while (*p && (*p)->size < e->size) {
@@ -183,6 +351,15 @@ static void equeue_mem_dealloc(equeue_t *q, struct equeue_event *e) {
     equeue_mutex_unlock(&q->memlock);
 }
 
+void equeue_get_stats(equeue_t *q, struct equeue_stats *stats) {
+    equeue_mutex_lock(&q->memlock);
+    stats->slab = q->slab.data - q->buffer;
+    stats->size = stats->slab + q->slab.size;
+    stats->used = q->usage.used;
+    stats->peak = q->usage.peak;
+    equeue_mutex_unlock(&q->memlock);
+}
+
 void *equeue_alloc(equeue_t *q, size_t size) {
     struct equeue_event *e = equeue_mem_alloc(q, size);
     if (!e) {
@@ -192,6 +369,7 @@ void *equeue_alloc(equeue_t *q, size_t size) {
     e->target = 0;
     e->period = -1;
     e->dtor = 0;
+    e->affinity = 0;
 
     return e + 1;
 }
@@ -208,14 +386,16 @@ void equeue_dealloc(equeue_t *q, void *p) {
 
 
 // equeue scheduling functions
-static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick) {
-    // setup event and hash local id with buffer offset for unique id
-    int id = (e->id << q->npw2) | ((unsigned char *)e - q->buffer);
-    e->target = tick + equeue_clampdiff(e->target, tick);
-    e->generation = q->generation;
-
-    equeue_mutex_lock(&q->queuelock);
-
+// insert an event into the queue, returns true if the event is the new
+// earliest event in the queue, queuelock must be held
+static bool equeue_insert(equeue_t *q, struct equeue_event *e) {
+#ifdef EQUEUE_SCHED_HEAP
+    // push onto the heap, ties are broken by insertion order
+    e->seq = q->seq++;
+    e->child = 0;
+    equeue_heap_push(q, e);
+    return (q->queue == e);
+#else
     // find the event slot
     struct equeue_event **p = &q->queue;
     while (*p && equeue_tickdiff((*p)->target, e->target) < 0) {
@@ -230,6 +410,7 @@ static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick) {
         }
 
         e->sibling = *p;
+        e->sibling->next = 0;
         e->sibling->ref = &e->sibling;
     } else {
         e->next = *p;
@@ -242,10 +423,22 @@ static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick) {
 
     *p = e;
     e->ref = p;
+    return (q->queue == e && !e->sibling);
+#endif
+}
+
+static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick) {
+    // setup event and hash local id with buffer offset for unique id
+    int id = (e->id << q->npw2) | ((unsigned char *)e - q->buffer);
+    e->target = tick + equeue_clampdiff(e->target, tick);
+    e->generation = q->generation;
+
+    equeue_mutex_lock(&q->queuelock);
+
+    bool head = equeue_insert(q, e);
 
     // notify background timer
-    if ((q->background.update && q->background.active) &&
-        (q->queue == e && !e->sibling)) {
+    if ((q->background.update && q->background.active) && head) {
         q->background.update(q->background.timer,
                 equeue_clampdiff(e->target, tick));
     }
@@ -255,6 +448,42 @@ static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick) {
     return id;
 }
 
+// move events posted with equeue_post_irq into the queue, queuelock
+// must be held
+static void equeue_drain(equeue_t *q, unsigned tick) {
+    // atomically take the whole inbox, the first attempt guesses it is
+    // empty and the failed exchanges load the current value
+    void *taken = 0;
+    while (!equeue_atomic_cas_ptr(
+            (void *volatile *)&q->inbox, &taken, 0)) {
+    }
+    struct equeue_event *es = (struct equeue_event *)taken;
+
+    // the inbox is a stack, reverse to match posting order
+    struct equeue_event *prev = 0;
+    while (es) {
+        struct equeue_event *e = es;
+        es = e->next;
+        e->next = prev;
+        prev = e;
+    }
+
+    while (prev) {
+        struct equeue_event *e = prev;
+        prev = e->next;
+
+        // events canceled in the inbox are dispatched as soon as
+        // possible, which deallocates them
+        if (!e->cb) {
+            e->target = tick;
+        }
+
+        e->target = tick + equeue_clampdiff(e->target, tick);
+        e->generation = q->generation;
+        equeue_insert(q, e);
+    }
+}
+
 static struct equeue_event *equeue_unqueue(equeue_t *q, int id) {
     // decode event from unique id and check that the local id matches
     struct equeue_event *e = (struct equeue_event *)
@@ -270,6 +499,12 @@ static struct equeue_event *equeue_unqueue(equeue_t *q, int id) {
     e->cb = 0;
     e->period = -1;
 
+    // events still in the inbox are cleaned up when drained
+    if (!e->ref) {
+        equeue_mutex_unlock(&q->queuelock);
+        return 0;
+    }
+
     int diff = equeue_tickdiff(e->target, q->tick);
     if (diff < 0 || (diff == 0 && e->generation != q->generation)) {
         equeue_mutex_unlock(&q->queuelock);
@@ -277,6 +512,9 @@ static struct equeue_event *equeue_unqueue(equeue_t *q, int id) {
     }
 
     // disentangle from queue
+#ifdef EQUEUE_SCHED_HEAP
+    equeue_heap_remove(q, e);
+#else
     if (e->sibling) {
         e->sibling->next = e->next;
         if (e->sibling->next) {
@@ -291,6 +529,7 @@ static struct equeue_event *equeue_unqueue(equeue_t *q, int id) {
             e->next->ref = e->ref;
         }
     }
+#endif
 
     equeue_incid(q, e);
     equeue_mutex_unlock(&q->queuelock);
@@ -301,12 +540,29 @@ static struct equeue_event *equeue_unqueue(equeue_t *q, int id) {
 static struct equeue_event *equeue_dequeue(equeue_t *q, unsigned target) {
     equeue_mutex_lock(&q->queuelock);
 
+    // pick up any lock-free posts, these must be inserted before marking
+    // a new generation so they appear in-flight if dispatched below
+    equeue_drain(q, target);
+
     // find all expired events and mark a new generation
     q->generation += 1;
     if (equeue_tickdiff(q->tick, target) <= 0) {
         q->tick = target;
     }
 
+#ifdef EQUEUE_SCHED_HEAP
+    // pop expired events, these are already in dispatch order
+    struct equeue_event *head = 0;
+    struct equeue_event **tail = &head;
+    while (q->queue && equeue_tickdiff(q->queue->target, target) <= 0) {
+        *tail = equeue_heap_pop(q);
+        tail = &(*tail)->next;
+    }
+
+    *tail = 0;
+
+    equeue_mutex_unlock(&q->queuelock);
+#else
     struct equeue_event *head = q->queue;
     struct equeue_event **p = &head;
     while (*p && equeue_tickdiff((*p)->target, target) <= 0) {
@@ -338,6 +594,7 @@ static struct equeue_event *equeue_dequeue(equeue_t *q, unsigned target) {
         *tail = prev;
         tail = &es->next;
     }
+#endif
 
     return head;
 }
@@ -349,7 +606,30 @@ int equeue_post(equeue_t *q, void (*cb)(void*), void *p) {
     e->target = tick + e->target;
 
     int id = equeue_enqueue(q, e, tick);
-    equeue_sema_signal(&q->eventsema);
+    equeue_notify(q);
+    return id;
+}
+
+int equeue_post_irq(equeue_t *q, void (*cb)(void*), void *p) {
+    // a backgrounded queue needs its timer updated, which requires the lock
+    if (q->background.update) {
+        return equeue_post(q, cb, p);
+    }
+
+    struct equeue_event *e = (struct equeue_event*)p - 1;
+    int id = (e->id << q->npw2) | ((unsigned char *)e - q->buffer);
+    e->cb = cb;
+    e->target = equeue_tick() + e->target;
+
+    // a null ref marks the event as sitting in the inbox
+    e->ref = 0;
+    void *next = 0;
+    do {
+        e->next = (struct equeue_event *)next;
+    } while (!equeue_atomic_cas_ptr(
+            (void *volatile *)&q->inbox, &next, e));
+
+    equeue_notify(q);
     return id;
 }
 
@@ -387,9 +667,42 @@ void equeue_break(equeue_t *q) {
     equeue_mutex_lock(&q->queuelock);
     q->break_requested = true;
     equeue_mutex_unlock(&q->queuelock);
+
+    // wake the owner directly, in a pool any idle worker may be woken
+    // by equeue_notify
     equeue_sema_signal(&q->eventsema);
 }
 
+// check for and clear a request from equeue_break
+static bool equeue_take_break(equeue_t *q) {
+    if (!q->break_requested) {
+        return false;
+    }
+
+    equeue_mutex_lock(&q->queuelock);
+    bool requested = q->break_requested;
+    q->break_requested = false;
+    equeue_mutex_unlock(&q->queuelock);
+    return requested;
+}
+
+static void equeue_run(equeue_t *q, struct equeue_event *e) {
+    // actually dispatch the callbacks
+    void (*cb)(void *) = e->cb;
+    if (cb) {
+        cb(e + 1);
+    }
+
+    // reenqueue periodic events or deallocate
+    if (e->period >= 0) {
+        e->target += e->period;
+        equeue_enqueue(q, e, equeue_tick());
+    } else {
+        equeue_incid(q, e);
+        equeue_dealloc(q, e+1);
+    }
+}
+
 void equeue_dispatch(equeue_t *q, int ms) {
     unsigned tick = equeue_tick();
     unsigned timeout = tick + ms;
@@ -403,21 +716,7 @@ void equeue_dispatch(equeue_t *q, int ms) {
         while (es) {
             struct equeue_event *e = es;
             es = e->next;
-
-            // actually dispatch the callbacks
-            void (*cb)(void *) = e->cb;
-            if (cb) {
-                cb(e + 1);
-            }
-
-            // reenqueue periodic events or deallocate
-            if (e->period >= 0) {
-                e->target += e->period;
-                equeue_enqueue(q, e, equeue_tick());
-            } else {
-                equeue_incid(q, e);
-                equeue_dealloc(q, e+1);
-            }
+            equeue_run(q, e);
         }
 
         int deadline = -1;
@@ -456,14 +755,8 @@ void equeue_dispatch(equeue_t *q, int ms) {
         equeue_sema_wait(&q->eventsema, deadline);
 
         // check if we were notified to break out of dispatch
-        if (q->break_requested) {
-            equeue_mutex_lock(&q->queuelock);
-            if (q->break_requested) {
-                q->break_requested = false;
-                equeue_mutex_unlock(&q->queuelock);
-                return;
-            }
-            equeue_mutex_unlock(&q->queuelock);
+        if (equeue_take_break(q)) {
+            return;
         }
 
         // update tick for next iteration
@@ -488,6 +781,11 @@ void equeue_event_dtor(void *p, void (*dtor)(void *)) {
     e->dtor = dtor;
 }
 
+void equeue_event_affinity(void *p, int worker) {
+    struct equeue_event *e = (struct equeue_event*)p - 1;
+    e->affinity = worker + 1;
+}
+
 
 // simple callbacks
 struct ecallback {
@@ -592,3 +890,194 @@ void equeue_chain(equeue_t *q, equeue_t *target) {
 
     equeue_background(q, equeue_chain_update, c);
 }
+
+
+// event queue pools
+int equeue_pool_create(equeue_pool_t *pool, equeue_t **queues, unsigned count) {
+    if (count > 8*sizeof(unsigned)) {
+        return -1;
+    }
+
+    pool->queues = queues;
+    pool->count = count;
+    pool->idle = 0;
+    pool->active = 0;
+    pool->break_requested = false;
+
+    int err = equeue_mutex_create(&pool->lock);
+    if (err < 0) {
+        return err;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        queues[i]->worker = i;
+        queues[i]->pool = pool;
+    }
+
+    return 0;
+}
+
+void equeue_pool_destroy(equeue_pool_t *pool) {
+    for (unsigned i = 0; i < pool->count; i++) {
+        equeue_t *q = pool->queues[i];
+        q->pool = 0;
+
+        // anything left in the batch returns to the queue to be cleaned up
+        // by equeue_destroy
+        while (q->batch) {
+            struct equeue_event *e = q->batch;
+            q->batch = e->next;
+            e->target = q->tick;
+            equeue_insert(q, e);
+        }
+    }
+
+    equeue_mutex_destroy(&pool->lock);
+}
+
+static void equeue_pool_wake(equeue_pool_t *pool, unsigned worker) {
+    // prefer the requested worker, but any idle worker can steal the work
+    equeue_mutex_lock(&pool->lock);
+    unsigned idle = pool->idle;
+    if (!(idle & (1U << worker)) && idle) {
+        worker = 0;
+        while (!(idle & (1U << worker))) {
+            worker++;
+        }
+    }
+
+    pool->idle &= ~(1U << worker);
+    equeue_mutex_unlock(&pool->lock);
+
+    equeue_sema_signal(&pool->queues[worker]->eventsema);
+}
+
+// take the next event from a queue's expired events that the worker is
+// allowed to run
+static struct equeue_event *equeue_pool_take(equeue_pool_t *pool,
+        equeue_t *q, unsigned worker, unsigned tick) {
+    struct equeue_event *es = equeue_dequeue(q, tick);
+
+    equeue_mutex_lock(&q->queuelock);
+    struct equeue_event **p = &q->batch;
+    while (*p) {
+        p = &(*p)->next;
+    }
+    *p = es;
+
+    // skip events pinned to other workers, noting who needs waking up
+    unsigned pinned = 0;
+    p = &q->batch;
+    while (*p && (*p)->affinity && (*p)->affinity != worker+1) {
+        pinned |= 1U << ((*p)->affinity-1);
+        p = &(*p)->next;
+    }
+
+    struct equeue_event *e = *p;
+    if (e) {
+        *p = e->next;
+    }
+
+    bool more = e && q->batch;
+    equeue_mutex_unlock(&q->queuelock);
+
+    for (unsigned i = 0; pinned; i++, pinned >>= 1) {
+        if ((pinned & 1) && i < pool->count) {
+            equeue_sema_signal(&pool->queues[i]->eventsema);
+        }
+    }
+
+    // ask an idle worker for help if there is more to do
+    if (more) {
+        equeue_pool_wake(pool, worker);
+    }
+
+    return e;
+}
+
+void equeue_pool_dispatch(equeue_pool_t *pool, unsigned worker, int ms) {
+    unsigned tick = equeue_tick();
+    unsigned timeout = tick + ms;
+    equeue_t *own = pool->queues[worker];
+    equeue_sema_t *sema = &own->eventsema;
+
+    equeue_mutex_lock(&pool->lock);
+    pool->active += 1;
+    equeue_mutex_unlock(&pool->lock);
+
+    // equeue_break on the worker's own queue stops just this worker
+    while (!pool->break_requested && !equeue_take_break(own)) {
+        // look for work in our own queue first, then steal from the others
+        equeue_t *q = 0;
+        struct equeue_event *e = 0;
+        for (unsigned i = 0; i < pool->count && !e; i++) {
+            q = pool->queues[(worker + i) % pool->count];
+            e = equeue_pool_take(pool, q, worker, tick);
+        }
+
+        if (e) {
+            equeue_run(q, e);
+        }
+
+        int deadline = -1;
+        tick = equeue_tick();
+
+        // check if we should stop dispatching soon
+        if (ms >= 0) {
+            deadline = equeue_tickdiff(timeout, tick);
+            if (deadline <= 0) {
+                break;
+            }
+        }
+
+        if (e) {
+            continue;
+        }
+
+        // mark ourselves idle so other workers can hand us work
+        equeue_mutex_lock(&pool->lock);
+        pool->idle |= 1U << worker;
+        equeue_mutex_unlock(&pool->lock);
+
+        // find closest deadline across all queues
+        for (unsigned i = 0; i < pool->count; i++) {
+            q = pool->queues[i];
+            equeue_mutex_lock(&q->queuelock);
+            if (q->queue) {
+                int diff = equeue_clampdiff(q->queue->target, tick);
+                if ((unsigned)diff < (unsigned)deadline) {
+                    deadline = diff;
+                }
+            }
+            equeue_mutex_unlock(&q->queuelock);
+        }
+
+        // wait for events
+        equeue_sema_wait(sema, deadline);
+
+        equeue_mutex_lock(&pool->lock);
+        pool->idle &= ~(1U << worker);
+        equeue_mutex_unlock(&pool->lock);
+
+        // update tick for next iteration
+        tick = equeue_tick();
+    }
+
+    // the last worker out clears the break request
+    equeue_mutex_lock(&pool->lock);
+    pool->active -= 1;
+    if (!pool->active) {
+        pool->break_requested = false;
+    }
+    equeue_mutex_unlock(&pool->lock);
+}
+
+void equeue_pool_break(equeue_pool_t *pool) {
+    equeue_mutex_lock(&pool->lock);
+    pool->break_requested = true;
+    equeue_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->count; i++) {
+        equeue_sema_signal(&pool->queues[i]->eventsema);
+    }
+}
@@ -32,6 +32,41 @@ extern "C" {
 #include <stdint.h>
 
 
+// Scheduler backend
+//
+// By default pending events are kept in a list of time slots sorted by
+// deadline, so posting an event is linear in the number of distinct pending
+// deadlines. Defining EQUEUE_SCHED_HEAP keeps pending events in a pairing
+// heap instead, making posting and canceling O(log n) amortized at the cost
+// of two additional words per event. Events with equal deadlines are still
+// dispatched in the order they were posted.
+//
+// Uncomment to select the heap scheduler or enable it through the
+// events.use-heap-scheduler configuration option.
+//#define EQUEUE_SCHED_HEAP
+
+#if !defined(EQUEUE_SCHED_HEAP)                 \
+ && defined(MBED_CONF_EVENTS_USE_HEAP_SCHEDULER) \
+ && MBED_CONF_EVENTS_USE_HEAP_SCHEDULER
+#define EQUEUE_SCHED_HEAP
+#endif
+
+// Allocator size classes
+//
+// Free chunks up to EQUEUE_MEM_BINS words larger than the event header are
+// kept in per-size bins, making the allocation and deallocation of small
+// events constant-time regardless of how many different event sizes are in
+// use. Larger chunks fall back to a single list sorted by size. Setting
+// EQUEUE_MEM_BINS to 0 disables the bins, saving a word per bin in the
+// equeue_t structure.
+#ifndef EQUEUE_MEM_BINS
+#if defined(MBED_CONF_EVENTS_MEM_BINS)
+#define EQUEUE_MEM_BINS MBED_CONF_EVENTS_MEM_BINS
+#else
+#define EQUEUE_MEM_BINS 16
+#endif
+#endif
+
 // The minimum size of an event
 // This size is guaranteed to fit events created by event_call
 #define EQUEUE_EVENT_SIZE (sizeof(struct equeue_event) + 2*sizeof(void*))
@@ -41,10 +76,15 @@ struct equeue_event {
     unsigned size;
     uint8_t id;
     uint8_t generation;
+    uint8_t affinity;
 
     struct equeue_event *next;
     struct equeue_event *sibling;
     struct equeue_event **ref;
+#ifdef EQUEUE_SCHED_HEAP
+    struct equeue_event *child;
+    unsigned seq;
+#endif
 
     unsigned target;
     int period;
@@ -57,31 +97,58 @@ struct equeue_event {
 // Event queue structure
 typedef struct equeue {
     struct equeue_event *queue;
+    struct equeue_event *volatile inbox;
+    struct equeue_event *batch;
     unsigned tick;
     bool break_requested;
     uint8_t generation;
+#ifdef EQUEUE_SCHED_HEAP
+    unsigned seq;
+#endif
 
     unsigned char *buffer;
     unsigned npw2;
     void *allocated;
 
     struct equeue_event *chunks;
+#if EQUEUE_MEM_BINS > 0
+    struct equeue_event *bins[EQUEUE_MEM_BINS];
+#endif
     struct equeue_slab {
         size_t size;
         unsigned char *data;
     } slab;
 
+    struct equeue_usage {
+        size_t used;
+        size_t peak;
+    } usage;
+
     struct equeue_background {
         bool active;
         void (*update)(void *timer, int ms);
         void *timer;
     } background;
 
+    struct equeue_pool *pool;
+    unsigned worker;
+
     equeue_sema_t eventsema;
     equeue_mutex_t queuelock;
     equeue_mutex_t memlock;
 } equeue_t;
 
+// Event queue pool structure
+typedef struct equeue_pool {
+    equeue_t **queues;
+    unsigned count;
+
+    unsigned idle;
+    unsigned active;
+    volatile bool break_requested;
+    equeue_mutex_t lock;
+} equeue_pool_t;
+
 
 // Queue lifetime operations
 //
@@ -142,8 +209,10 @@ int equeue_call_every(equeue_t *queue, int ms, void (*cb)(void *), void *data);
 //
 // The equeue allocator is designed to minimize jitter in interrupt contexts as
 // well as avoid memory fragmentation on small devices. The allocator achieves
-// both constant-runtime and zero-fragmentation for fixed-size events, however
-// grows linearly as the quantity of different sized allocations increases.
+// both constant-runtime and zero-fragmentation for fixed-size events. Events
+// that fit in the allocator's size bins (see EQUEUE_MEM_BINS) stay
+// constant-runtime as the quantity of different sized allocations increases,
+// larger events grow linearly.
 //
 // The equeue_alloc function returns a pointer to the event's allocated memory
 // and acts as a handle to the underlying event. If there is not enough memory
@@ -151,14 +220,34 @@ int equeue_call_every(equeue_t *queue, int ms, void (*cb)(void *), void *data);
 void *equeue_alloc(equeue_t *queue, size_t size);
 void equeue_dealloc(equeue_t *queue, void *event);
 
+// Query memory usage of an event queue
+//
+// The equeue_get_stats function fills out the provided structure with the
+// current state of the event queue's buffer. The slab field is a high-water
+// mark of how much of the buffer has ever been carved into events, which can
+// be used to tune the buffer size passed to equeue_create.
+//
+// The equeue_get_stats function is irq safe.
+struct equeue_stats {
+    size_t size;    // size of the event queue's buffer in bytes
+    size_t slab;    // bytes of the buffer that have been carved into events
+    size_t used;    // bytes in events that are currently allocated
+    size_t peak;    // largest number of bytes allocated at any one time
+};
+
+void equeue_get_stats(equeue_t *queue, struct equeue_stats *stats);
+
 // Configure an allocated event
 //
 // equeue_event_delay  - Millisecond delay before dispatching an event
 // equeue_event_period - Millisecond period for repeating dispatching an event
 // equeue_event_dtor   - Destructor to run when the event is deallocated
+// equeue_event_affinity - Pool worker that should run the event, or -1 for
+//                       any worker, ignored outside of equeue_pool_dispatch
 void equeue_event_delay(void *event, int ms);
 void equeue_event_period(void *event, int ms);
 void equeue_event_dtor(void *event, void (*dtor)(void *));
+void equeue_event_affinity(void *event, int worker);
 
 // Post an event onto the event queue
 //
@@ -174,6 +263,20 @@ void equeue_event_dtor(void *event, void (*dtor)(void *));
 // be passed to equeue_cancel.
 int equeue_post(equeue_t *queue, void (*cb)(void *), void *event);
 
+// Post an event onto the event queue without locking
+//
+// The equeue_post_irq function behaves like equeue_post, but pushes the event
+// onto a lock-free inbox that the dispatch loop moves into the queue. This
+// keeps the cost of posting from interrupts low and constant regardless of
+// how many events are pending. The event must still be allocated with
+// equeue_alloc, which takes the memory lock.
+//
+// Events posted with equeue_post_irq are dispatched in the order they were
+// posted relative to each other, but may be reordered relative to events
+// with the same deadline posted with equeue_post. If the queue has been
+// backgrounded or chained, equeue_post_irq falls back to equeue_post.
+int equeue_post_irq(equeue_t *queue, void (*cb)(void *), void *event);
+
 // Cancel an in-flight event
 //
 // Attempts to cancel an event referenced by the unique id returned from
@@ -222,6 +325,29 @@ void equeue_background(equeue_t *queue,
 // the context of a dispatch loop while still being managed independently.
 void equeue_chain(equeue_t *queue, equeue_t *target);
 
+// Dispatch a set of event queues from multiple threads
+//
+// An event queue pool lets several threads cooperatively dispatch a set of
+// event queues. Each worker thread calls equeue_pool_dispatch with its index,
+// and owns the queue at that index in the array passed to equeue_pool_create.
+// Workers dispatch their own queue first, but workers that run out of events
+// steal expired events from the other queues, so a long-running event only
+// blocks the worker running it. Events with an affinity set through
+// equeue_event_affinity are only run by the requested worker.
+//
+// Events from the same queue may run concurrently and complete out of order.
+// A pool supports up to 8*sizeof(unsigned) workers, and the queues must not be
+// dispatched, backgrounded or chained while part of a pool.
+//
+// The equeue_pool_dispatch function follows the same timeout rules as
+// equeue_dispatch. The equeue_pool_break function forces all workers to
+// return from equeue_pool_dispatch, while equeue_break on a queue in the pool
+// only forces the worker owning that queue to return.
+int equeue_pool_create(equeue_pool_t *pool, equeue_t **queues, unsigned count);
+void equeue_pool_destroy(equeue_pool_t *pool);
+void equeue_pool_dispatch(equeue_pool_t *pool, unsigned worker, int ms);
+void equeue_pool_break(equeue_pool_t *pool);
+
 
 #ifdef __cplusplus
 }
@@ -173,4 +173,10 @@ bool equeue_sema_wait(equeue_sema_t *s, int ms) {
 
 #endif
 
+
+// Atomic operations
+bool equeue_atomic_cas_ptr(void *volatile *ptr, void **expected, void *desired) {
+    return core_util_atomic_cas_ptr(ptr, expected, desired);
+}
+
 #endif
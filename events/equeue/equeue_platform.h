@@ -143,6 +143,16 @@ void equeue_sema_signal(equeue_sema_t *sema);
 bool equeue_sema_wait(equeue_sema_t *sema, int ms);
 
 
+// Platform atomic operations
+//
+// The equeue_atomic_cas_ptr function atomically compares the pointer at ptr
+// to the value at expected and, if they match, replaces it with the desired
+// value. Returns true if the pointer was replaced, otherwise updates expected
+// with the current value of the pointer. Must be safe to call from interrupt
+// contexts, and act as a full memory barrier.
+bool equeue_atomic_cas_ptr(void *volatile *ptr, void **expected, void *desired);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -103,4 +103,16 @@ bool equeue_sema_wait(equeue_sema_t *s, int ms) {
     return signal;
 }
 
+
+// Atomic operations
+bool equeue_atomic_cas_ptr(void *volatile *ptr, void **expected, void *desired) {
+    void *current = __sync_val_compare_and_swap(ptr, *expected, desired);
+    if (current != *expected) {
+        *expected = current;
+        return false;
+    }
+
+    return true;
+}
+
 #endif
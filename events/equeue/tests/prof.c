@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 
 // Performance measurement utils
@@ -175,6 +176,31 @@ void equeue_alloc_many_prof(int count) {
     equeue_destroy(&q);
 }
 
+void equeue_alloc_churn_prof(int count) {
+    struct equeue q;
+    equeue_create(&q, 4*count*(EQUEUE_EVENT_SIZE + 16*sizeof(int)));
+
+    void *es[count];
+
+    for (int i = 0; i < count; i++) {
+        es[i] = equeue_alloc(&q, ((i*7) % 16) * sizeof(int));
+    }
+
+    unsigned seed = 1;
+    prof_loop() {
+        seed = seed*1103515245 + 12345;
+        int i = (seed >> 16) % count;
+        size_t size = ((seed >> 8) % 16) * sizeof(int);
+        equeue_dealloc(&q, es[i]);
+
+        prof_start();
+        es[i] = equeue_alloc(&q, size);
+        prof_stop();
+    }
+
+    equeue_destroy(&q);
+}
+
 void equeue_post_prof(void) {
     struct equeue q;
     equeue_create(&q, EQUEUE_EVENT_SIZE);
@@ -213,6 +239,47 @@ void equeue_post_many_prof(int count) {
     equeue_destroy(&q);
 }
 
+void equeue_post_irq_prof(void) {
+    struct equeue q;
+    equeue_create(&q, EQUEUE_EVENT_SIZE);
+
+    prof_loop() {
+        void *e = equeue_alloc(&q, 0);
+
+        prof_start();
+        int id = equeue_post_irq(&q, no_func, e);
+        prof_stop();
+
+        equeue_cancel(&q, id);
+        equeue_dispatch(&q, 0);
+    }
+
+    equeue_destroy(&q);
+}
+
+void equeue_post_irq_spread_many_prof(int count) {
+    struct equeue q;
+    equeue_create(&q, count*EQUEUE_EVENT_SIZE);
+
+    for (int i = 0; i < count-1; i++) {
+        equeue_call_in(&q, 1000 + i, no_func, 0);
+    }
+
+    prof_loop() {
+        void *e = equeue_alloc(&q, 0);
+        equeue_event_delay(e, 1000 + count);
+
+        prof_start();
+        int id = equeue_post_irq(&q, no_func, e);
+        prof_stop();
+
+        equeue_cancel(&q, id);
+        equeue_dispatch(&q, 0);
+    }
+
+    equeue_destroy(&q);
+}
+
 void equeue_post_future_prof(void) {
     struct equeue q;
     equeue_create(&q, EQUEUE_EVENT_SIZE);
@@ -253,6 +320,30 @@ void equeue_post_future_many_prof(int count) {
     equeue_destroy(&q);
 }
 
+void equeue_post_spread_many_prof(int count) {
+    struct equeue q;
+    equeue_create(&q, count*EQUEUE_EVENT_SIZE);
+
+    // pending events with distinct deadlines, the worst case for a
+    // sorted insertion
+    for (int i = 0; i < count-1; i++) {
+        equeue_call_in(&q, 1000 + i, no_func, 0);
+    }
+
+    prof_loop() {
+        void *e = equeue_alloc(&q, 0);
+        equeue_event_delay(e, 1000 + count);
+
+        prof_start();
+        int id = equeue_post(&q, no_func, e);
+        prof_stop();
+
+        equeue_cancel(&q, id);
+    }
+
+    equeue_destroy(&q);
+}
+
 void equeue_dispatch_prof(void) {
     struct equeue q;
     equeue_create(&q, EQUEUE_EVENT_SIZE);
@@ -285,6 +376,77 @@ void equeue_dispatch_many_prof(int count) {
     equeue_destroy(&q);
 }
 
+struct spin {
+    int *done;
+};
+
+static void spin_func(void *p) {
+    struct spin *s = (struct spin *)p;
+    prof_cycle_t start = prof_cycle();
+    while (prof_cycle() - start < 100000) {
+        __asm__ volatile ("");
+    }
+
+    __sync_fetch_and_add(s->done, 1);
+}
+
+struct pool_worker {
+    pthread_t thread;
+    equeue_pool_t *pool;
+    unsigned worker;
+};
+
+static void *pool_worker_dispatch(void *p) {
+    struct pool_worker *w = (struct pool_worker *)p;
+    equeue_pool_dispatch(w->pool, w->worker, -1);
+    return 0;
+}
+
+void equeue_pool_dispatch_prof(int count) {
+    struct equeue qs[count];
+    equeue_t *queues[count];
+    for (int i = 0; i < count; i++) {
+        equeue_create(&qs[i], 100*(EQUEUE_EVENT_SIZE + sizeof(struct spin)));
+        queues[i] = &qs[i];
+    }
+
+    equeue_pool_t pool;
+    equeue_pool_create(&pool, queues, count);
+
+    struct pool_worker workers[count];
+    for (int i = 0; i < count; i++) {
+        workers[i].pool = &pool;
+        workers[i].worker = i;
+        pthread_create(&workers[i].thread, 0, pool_worker_dispatch, &workers[i]);
+    }
+
+    // cpu-bound events all posted to the first queue
+    prof_loop() {
+        int done = 0;
+        for (int i = 0; i < 100; i++) {
+            struct spin *s = equeue_alloc(&qs[0], sizeof(struct spin));
+            s->done = &done;
+            equeue_post(&qs[0], spin_func, s);
+        }
+
+        prof_start();
+        while (__sync_fetch_and_add(&done, 0) < 100) {
+            usleep(10);
+        }
+        prof_stop();
+    }
+
+    equeue_pool_break(&pool);
+    for (int i = 0; i < count; i++) {
+        pthread_join(workers[i].thread, 0);
+    }
+
+    equeue_pool_destroy(&pool);
+    for (int i = 0; i < count; i++) {
+        equeue_destroy(&qs[i]);
+    }
+}
+
 void equeue_cancel_prof(void) {
     struct equeue q;
     equeue_create(&q, EQUEUE_EVENT_SIZE);
@@ -319,6 +481,44 @@ void equeue_cancel_many_prof(int count) {
     equeue_destroy(&q);
 }
 
+void equeue_cancel_spread_many_prof(int count) {
+    struct equeue q;
+    equeue_create(&q, count*EQUEUE_EVENT_SIZE);
+
+    for (int i = 0; i < count-1; i++) {
+        equeue_call_in(&q, 1000 + i, no_func, 0);
+    }
+
+    prof_loop() {
+        int id = equeue_call_in(&q, 1000 + count/2, no_func, 0);
+
+        prof_start();
+        equeue_cancel(&q, id);
+        prof_stop();
+    }
+
+    equeue_destroy(&q);
+}
+
+void equeue_dispatch_spread_many_prof(int count) {
+    struct equeue q;
+    equeue_create(&q, count*EQUEUE_EVENT_SIZE);
+
+    for (int i = 0; i < count-1; i++) {
+        equeue_call_in(&q, 1000 + i, no_func, 0);
+    }
+
+    prof_loop() {
+        equeue_call(&q, no_func, 0);
+
+        prof_start();
+        equeue_dispatch(&q, 0);
+        prof_stop();
+    }
+
+    equeue_destroy(&q);
+}
+
 void equeue_alloc_size_prof(void) {
     size_t size = 32*EQUEUE_EVENT_SIZE;
 
@@ -379,6 +579,31 @@ void equeue_alloc_fragmented_size_prof(int count) {
     equeue_destroy(&q);
 }
 
+void equeue_alloc_churn_size_prof(int count) {
+    struct equeue q;
+    equeue_create(&q, 4*count*(EQUEUE_EVENT_SIZE + 16*sizeof(int)));
+
+    void *es[count];
+
+    for (int i = 0; i < count; i++) {
+        es[i] = equeue_alloc(&q, ((i*7) % 16) * sizeof(int));
+    }
+
+    unsigned seed = 1;
+    for (int j = 0; j < 100*count; j++) {
+        seed = seed*1103515245 + 12345;
+        int i = (seed >> 16) % count;
+        size_t size = ((seed >> 8) % 16) * sizeof(int);
+        equeue_dealloc(&q, es[i]);
+        es[i] = equeue_alloc(&q, size);
+    }
+
+    struct equeue_stats stats;
+    equeue_get_stats(&q, &stats);
+    prof_result(stats.slab, "bytes");
+
+    equeue_destroy(&q);
+}
 
 // Entry point
 int main() {
@@ -389,19 +614,36 @@ int main() {
     prof_measure(equeue_tick_prof);
     prof_measure(equeue_alloc_prof);
     prof_measure(equeue_post_prof);
+    prof_measure(equeue_post_irq_prof);
     prof_measure(equeue_post_future_prof);
     prof_measure(equeue_dispatch_prof);
     prof_measure(equeue_cancel_prof);
 
     prof_measure(equeue_alloc_many_prof, 1000);
+    prof_measure(equeue_alloc_churn_prof, 1000);
     prof_measure(equeue_post_many_prof, 1000);
     prof_measure(equeue_post_future_many_prof, 1000);
     prof_measure(equeue_dispatch_many_prof, 100);
     prof_measure(equeue_cancel_many_prof, 100);
 
+    prof_measure(equeue_post_spread_many_prof, 10);
+    prof_measure(equeue_post_spread_many_prof, 100);
+    prof_measure(equeue_post_spread_many_prof, 1000);
+    prof_measure(equeue_post_irq_spread_many_prof, 1000);
+    prof_measure(equeue_cancel_spread_many_prof, 10);
+    prof_measure(equeue_cancel_spread_many_prof, 100);
+    prof_measure(equeue_cancel_spread_many_prof, 1000);
+    prof_measure(equeue_dispatch_spread_many_prof, 10);
+    prof_measure(equeue_dispatch_spread_many_prof, 100);
+    prof_measure(equeue_dispatch_spread_many_prof, 1000);
+    prof_measure(equeue_pool_dispatch_prof, 1);
+    prof_measure(equeue_pool_dispatch_prof, 2);
+    prof_measure(equeue_pool_dispatch_prof, 4);
+
     prof_measure(equeue_alloc_size_prof);
     prof_measure(equeue_alloc_many_size_prof, 1000);
     prof_measure(equeue_alloc_fragmented_size_prof, 1000);
+    prof_measure(equeue_alloc_churn_size_prof, 1000);
 
     printf("done!\n");
 }
@@ -293,6 +293,60 @@ void cancel_test(int N) {
     equeue_destroy(&q);
 }
 
+struct order {
+    int *log;
+    int *count;
+    int key;
+};
+
+void order_func(void *p) {
+    struct order *order = (struct order *)p;
+    order->log[(*order->count)++] = order->key;
+}
+
+void ordering_test(int N) {
+    equeue_t q;
+    int err = equeue_create(&q, 2*N*(EQUEUE_EVENT_SIZE+sizeof(struct order)));
+    test_assert(!err);
+
+    int count = 0;
+    int *log = malloc(2*N*sizeof(int));
+    int *ids = malloc(2*N*sizeof(int));
+
+    // post deadlines out of order, with each deadline posted twice
+    for (int i = 0; i < 2*N; i++) {
+        int slot = ((i/2) * 7) % N;
+        struct order *order = equeue_alloc(&q, sizeof(struct order));
+        test_assert(order);
+
+        order->log = log;
+        order->count = &count;
+        order->key = 2*slot + (i % 2);
+        equeue_event_delay(order, slot*10);
+        ids[i] = equeue_post(&q, order_func, order);
+        test_assert(ids[i]);
+    }
+
+    // cancel a handful to shuffle the queue's internal structure
+    int canceled = 0;
+    for (int i = 0; i < 2*N; i += 5) {
+        equeue_cancel(&q, ids[i]);
+        canceled++;
+    }
+
+    equeue_dispatch(&q, N*10 + 20);
+    test_assert(count == 2*N - canceled);
+
+    for (int i = 1; i < count; i++) {
+        test_assert(log[i-1] < log[i]);
+    }
+
+    free(ids);
+    free(log);
+
+    equeue_destroy(&q);
+}
+
 void cancel_inflight_test(void) {
     equeue_t q;
     int err = equeue_create(&q, 2048);
@@ -615,6 +669,45 @@ void unchain_test(void) {
     equeue_destroy(&q2);
 }
 
+void mem_stats_test(void) {
+    equeue_t q;
+    int err = equeue_create(&q, 2048);
+    test_assert(!err);
+
+    struct equeue_stats stats;
+    equeue_get_stats(&q, &stats);
+    test_assert(stats.size == 2048);
+    test_assert(stats.slab == 0 && stats.used == 0 && stats.peak == 0);
+
+    void *es[8];
+    for (int i = 0; i < 8; i++) {
+        es[i] = equeue_alloc(&q, i*sizeof(int));
+        test_assert(es[i]);
+    }
+
+    equeue_get_stats(&q, &stats);
+    size_t slab = stats.slab;
+    test_assert(slab > 0 && stats.used == slab && stats.peak == slab);
+
+    for (int i = 0; i < 8; i++) {
+        equeue_dealloc(&q, es[i]);
+    }
+
+    equeue_get_stats(&q, &stats);
+    test_assert(stats.used == 0 && stats.peak == slab && stats.slab == slab);
+
+    // reallocating the same sizes should be satisfied from free chunks
+    for (int i = 7; i >= 0; i--) {
+        es[i] = equeue_alloc(&q, i*sizeof(int));
+        test_assert(es[i]);
+    }
+
+    equeue_get_stats(&q, &stats);
+    test_assert(stats.slab == slab && stats.used == slab);
+
+    equeue_destroy(&q);
+}
+
 // Barrage tests
 void simple_barrage_test(int N) {
     equeue_t q;
@@ -707,6 +800,303 @@ void multithreaded_barrage_test(int N) {
     equeue_destroy(&q);
 }
 
+// Lock-free posting tests
+void post_irq_test(void) {
+    equeue_t q;
+    int err = equeue_create(&q, 2048);
+    test_assert(!err);
+
+    int count = 0;
+    int log[8];
+    int ids[8];
+
+    for (int i = 0; i < 8; i++) {
+        struct order *order = equeue_alloc(&q, sizeof(struct order));
+        test_assert(order);
+
+        order->log = log;
+        order->count = &count;
+        order->key = i;
+        equeue_event_delay(order, (i % 2) ? 10 : 0);
+        ids[i] = equeue_post_irq(&q, order_func, order);
+        test_assert(ids[i]);
+    }
+
+    // canceling events still in the inbox must prevent dispatch
+    equeue_cancel(&q, ids[2]);
+    equeue_cancel(&q, ids[3]);
+
+    test_assert(equeue_timeleft(&q, ids[5]) > 0);
+
+    equeue_dispatch(&q, 0);
+    test_assert(count == 3);
+    test_assert(log[0] == 0 && log[1] == 4 && log[2] == 6);
+
+    // canceling a drained event must remove it from the queue
+    equeue_cancel(&q, ids[7]);
+
+    equeue_dispatch(&q, 20);
+    test_assert(count == 5);
+    test_assert(log[3] == 1 && log[4] == 5);
+
+    equeue_destroy(&q);
+}
+
+struct irq_producer {
+    pthread_t thread;
+    equeue_t *q;
+    int *touched;
+    int count;
+};
+
+static void *irq_producer_thread(void *p) {
+    struct irq_producer *t = (struct irq_producer *)p;
+
+    for (int i = 0; i < t->count; i++) {
+        struct indirect *e;
+        while (!(e = equeue_alloc(t->q, sizeof(struct indirect)))) {
+            usleep(100);
+        }
+
+        e->touched = t->touched;
+        equeue_post_irq(t->q, indirect_func, e);
+    }
+
+    return 0;
+}
+
+void multithreaded_post_irq_test(int N) {
+    equeue_t q;
+    int err = equeue_create(&q, 64*(EQUEUE_EVENT_SIZE+sizeof(struct indirect)));
+    test_assert(!err);
+
+    struct ethread t;
+    t.q = &q;
+    t.ms = -1;
+    err = pthread_create(&t.thread, 0, ethread_dispatch, &t);
+    test_assert(!err);
+
+    int touched = 0;
+    struct irq_producer producers[N];
+    for (int i = 0; i < N; i++) {
+        producers[i].q = &q;
+        producers[i].touched = &touched;
+        producers[i].count = 1000;
+        err = pthread_create(&producers[i].thread, 0,
+                irq_producer_thread, &producers[i]);
+        test_assert(!err);
+    }
+
+    for (int i = 0; i < N; i++) {
+        err = pthread_join(producers[i].thread, 0);
+        test_assert(!err);
+    }
+
+    // let the dispatcher catch up before stopping it
+    for (int i = 0; i < 100 && touched < N*1000; i++) {
+        usleep(1000);
+    }
+
+    equeue_break(&q);
+    err = pthread_join(t.thread, 0);
+    test_assert(!err);
+
+    test_assert(touched == N*1000);
+
+    equeue_destroy(&q);
+}
+
+// Pool tests
+struct pworker {
+    pthread_t thread;
+    equeue_pool_t *pool;
+    unsigned worker;
+    int ms;
+};
+
+static void *pworker_dispatch(void *p) {
+    struct pworker *t = (struct pworker *)p;
+    equeue_pool_dispatch(t->pool, t->worker, t->ms);
+    return 0;
+}
+
+struct affine {
+    pthread_t *expected;
+    struct pworker *workers;
+    int count;
+    int *ran;
+    int *touched;
+    int *misplaced;
+};
+
+void affine_func(void *p) {
+    struct affine *a = (struct affine *)p;
+    if (a->expected && !pthread_equal(*a->expected, pthread_self())) {
+        __sync_fetch_and_add(a->misplaced, 1);
+    }
+
+    for (int i = 0; i < a->count; i++) {
+        if (pthread_equal(a->workers[i].thread, pthread_self())) {
+            __sync_fetch_and_add(&a->ran[i], 1);
+        }
+    }
+
+    usleep(10000);
+    __sync_fetch_and_add(a->touched, 1);
+}
+
+void pool_test(int N) {
+    equeue_t qs[N];
+    equeue_t *queues[N];
+    for (int i = 0; i < N; i++) {
+        int err = equeue_create(&qs[i], 64*(EQUEUE_EVENT_SIZE+sizeof(struct affine)));
+        test_assert(!err);
+        queues[i] = &qs[i];
+    }
+
+    equeue_pool_t pool;
+    int err = equeue_pool_create(&pool, queues, N);
+    test_assert(!err);
+
+    struct pworker workers[N];
+    for (int i = 0; i < N; i++) {
+        workers[i].pool = &pool;
+        workers[i].worker = i;
+        workers[i].ms = -1;
+        err = pthread_create(&workers[i].thread, 0, pworker_dispatch, &workers[i]);
+        test_assert(!err);
+    }
+
+    // everything lands on the first queue, the other workers must steal
+    // the work while the first worker is busy
+    int touched = 0;
+    int misplaced = 0;
+    int ran[N];
+    for (int i = 0; i < N; i++) {
+        ran[i] = 0;
+    }
+    unsigned start = equeue_tick();
+    for (int i = 0; i < 8*N; i++) {
+        struct affine *a = equeue_alloc(&qs[0], sizeof(struct affine));
+        test_assert(a);
+
+        a->workers = workers;
+        a->count = N;
+        a->ran = ran;
+        a->touched = &touched;
+        a->misplaced = &misplaced;
+        a->expected = 0;
+        if (i % 4 == 0) {
+            a->expected = &workers[N-1].thread;
+            equeue_event_affinity(a, N-1);
+        }
+
+        int id = equeue_post(&qs[0], affine_func, a);
+        test_assert(id);
+    }
+
+    while (__sync_fetch_and_add(&touched, 0) < 8*N &&
+            equeue_tick() - start < 10000) {
+        usleep(1000);
+    }
+
+    equeue_pool_break(&pool);
+    for (int i = 0; i < N; i++) {
+        err = pthread_join(workers[i].thread, 0);
+        test_assert(!err);
+    }
+
+    test_assert(touched == 8*N);
+    test_assert(misplaced == 0);
+
+    // the pinned events all ran on the last worker, and the first worker
+    // did not run everything else itself
+    int total = 0;
+    for (int i = 0; i < N; i++) {
+        total += ran[i];
+    }
+    test_assert(total == 8*N);
+    test_assert(ran[N-1] >= 2*N);
+    test_assert(ran[0] < 8*N - 2*N);
+
+    equeue_pool_destroy(&pool);
+    for (int i = 0; i < N; i++) {
+        equeue_destroy(&qs[i]);
+    }
+}
+
+void pool_break_test(void) {
+    equeue_t qs[2];
+    equeue_t *queues[2] = {&qs[0], &qs[1]};
+    for (int i = 0; i < 2; i++) {
+        int err = equeue_create(&qs[i], 2048);
+        test_assert(!err);
+    }
+
+    equeue_pool_t pool;
+    int err = equeue_pool_create(&pool, queues, 2);
+    test_assert(!err);
+
+    struct pworker workers[2];
+    for (int i = 0; i < 2; i++) {
+        workers[i].pool = &pool;
+        workers[i].worker = i;
+        workers[i].ms = -1;
+        err = pthread_create(&workers[i].thread, 0, pworker_dispatch, &workers[i]);
+        test_assert(!err);
+    }
+
+    // breaking a queue stops only the worker owning it
+    equeue_break(&qs[1]);
+    err = pthread_join(workers[1].thread, 0);
+    test_assert(!err);
+
+    int touched = 0;
+    equeue_call(&qs[1], simple_func, &touched);
+    while (!__sync_fetch_and_add(&touched, 0)) {
+        usleep(1000);
+    }
+
+    equeue_pool_break(&pool);
+    err = pthread_join(workers[0].thread, 0);
+    test_assert(!err);
+    equeue_pool_destroy(&pool);
+
+    // the break was consumed, so later dispatches run normally
+    equeue_call_in(&qs[1], 5, simple_func, &touched);
+    equeue_dispatch(&qs[1], 20);
+    test_assert(touched == 2);
+
+    for (int i = 0; i < 2; i++) {
+        equeue_destroy(&qs[i]);
+    }
+}
+
+void pool_timeout_test(void) {
+    equeue_t qs[2];
+    equeue_t *queues[2] = {&qs[0], &qs[1]};
+    for (int i = 0; i < 2; i++) {
+        int err = equeue_create(&qs[i], 2048);
+        test_assert(!err);
+    }
+
+    equeue_pool_t pool;
+    int err = equeue_pool_create(&pool, queues, 2);
+    test_assert(!err);
+
+    int touched = 0;
+    equeue_call_every(&qs[1], 10, simple_func, &touched);
+
+    // a single worker dispatches both queues
+    equeue_pool_dispatch(&pool, 0, 55);
+    test_assert(touched == 5);
+
+    equeue_pool_destroy(&pool);
+    for (int i = 0; i < 2; i++) {
+        equeue_destroy(&qs[i]);
+    }
+}
+
 struct count_and_queue
 {
     int p;
@@ -755,6 +1145,7 @@ int main() {
     test_run(destructor_test);
     test_run(allocation_failure_test);
     test_run(cancel_test, 20);
+    test_run(ordering_test, 20);
     test_run(cancel_inflight_test);
     test_run(cancel_unnecessarily_test);
     test_run(loop_protect_test);
@@ -766,10 +1157,16 @@ int main() {
     test_run(background_test);
     test_run(chain_test);
     test_run(unchain_test);
+    test_run(mem_stats_test);
     test_run(multithread_test);
     test_run(simple_barrage_test, 20);
     test_run(fragmenting_barrage_test, 20);
     test_run(multithreaded_barrage_test, 20);
+    test_run(post_irq_test);
+    test_run(multithreaded_post_irq_test, 8);
+    test_run(pool_test, 4);
+    test_run(pool_break_test);
+    test_run(pool_timeout_test);
     test_run(break_request_cleared_on_timeout);
 
     printf("done!\n");
@@ -0,0 +1,268 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed.h"
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#include "HeapBlockDevice.h"
+#include "ProfilingBlockDevice.h"
+#include "CachingBlockDevice.h"
+#include "LittleFileSystem.h"
+#include "FATFileSystem.h"
+#include <stdlib.h>
+
+using namespace utest::v1;
+
+#ifndef MBED_EXTENDED_TESTS
+    #error [NOT_SUPPORTED] Filesystem tests not supported by default
+#endif
+
+static const bd_size_t read_size = 16;
+static const bd_size_t prog_size = 16;
+static const bd_size_t erase_size = 512;
+static const bd_size_t num_blocks = 64;
+static const bd_size_t test_buf_size = 1024;
+static const int file_size = 8192;
+static const int file_chunk = 64;
+
+// Profiler that also counts the operations reaching the device
+class OpCountingBlockDevice : public ProfilingBlockDevice
+{
+public:
+    OpCountingBlockDevice(BlockDevice *bd) : ProfilingBlockDevice(bd), reads(0), programs(0), erases(0) {}
+
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        reads++;
+        return ProfilingBlockDevice::read(buffer, addr, size);
+    }
+
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        programs++;
+        return ProfilingBlockDevice::program(buffer, addr, size);
+    }
+
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        erases++;
+        return ProfilingBlockDevice::erase(addr, size);
+    }
+
+    uint32_t reads;
+    uint32_t programs;
+    uint32_t erases;
+};
+
+// Random reads, programs and erases compared against the uncached device
+void test_caching()
+{
+    HeapBlockDevice heap_bd(num_blocks * erase_size, read_size, prog_size, erase_size);
+    HeapBlockDevice ref_bd(num_blocks * erase_size, read_size, prog_size, erase_size);
+    CachingBlockDevice bd(&heap_bd, 4);
+    uint8_t *write_buf = new uint8_t[test_buf_size];
+    uint8_t *read_buf = new uint8_t[test_buf_size];
+    uint8_t *ref_buf = new uint8_t[test_buf_size];
+
+    // Nothing to write back before init
+    int err = bd.sync();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+    err = ref_bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    TEST_ASSERT_EQUAL(num_blocks * erase_size, bd.size());
+    TEST_ASSERT_EQUAL(read_size, bd.get_read_size());
+    TEST_ASSERT_EQUAL(prog_size, bd.get_program_size());
+    TEST_ASSERT_EQUAL(erase_size, bd.get_erase_size());
+
+    err = bd.erase(0, bd.size());
+    TEST_ASSERT_EQUAL(0, err);
+    err = ref_bd.erase(0, ref_bd.size());
+    TEST_ASSERT_EQUAL(0, err);
+
+    srand(1);
+    for (int i = 0; i < 2000; i++) {
+        bd_size_t size = prog_size * (1 + rand() % (test_buf_size / prog_size));
+        bd_addr_t addr = prog_size * (rand() % ((bd.size() - size) / prog_size + 1));
+
+        switch (rand() % 8) {
+            case 0:
+                addr = addr - addr % erase_size;
+                size = erase_size;
+                err = bd.erase(addr, size);
+                TEST_ASSERT_EQUAL(0, err);
+                err = ref_bd.erase(addr, size);
+                TEST_ASSERT_EQUAL(0, err);
+                break;
+
+            case 1:
+            case 2:
+            case 3:
+                for (bd_size_t j = 0; j < size; j++) {
+                    write_buf[j] = 0xff & rand();
+                }
+                err = bd.program(write_buf, addr, size);
+                TEST_ASSERT_EQUAL(0, err);
+                err = ref_bd.program(write_buf, addr, size);
+                TEST_ASSERT_EQUAL(0, err);
+                break;
+
+            default:
+                err = bd.read(read_buf, addr, size);
+                TEST_ASSERT_EQUAL(0, err);
+                err = ref_bd.read(ref_buf, addr, size);
+                TEST_ASSERT_EQUAL(0, err);
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(ref_buf, read_buf, size);
+                break;
+        }
+    }
+
+    // Everything buffered reaches the device on sync
+    err = bd.sync();
+    TEST_ASSERT_EQUAL(0, err);
+    for (bd_addr_t addr = 0; addr < bd.size(); addr += test_buf_size) {
+        err = heap_bd.read(read_buf, addr, test_buf_size);
+        TEST_ASSERT_EQUAL(0, err);
+        err = ref_bd.read(ref_buf, addr, test_buf_size);
+        TEST_ASSERT_EQUAL(0, err);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(ref_buf, read_buf, test_buf_size);
+    }
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+    delete[] write_buf;
+    delete[] read_buf;
+    delete[] ref_buf;
+}
+
+// Writes a file in small chunks, reads it back and removes it
+static void file_workload(FileSystem *fs)
+{
+    uint8_t buffer[file_chunk];
+
+    File file;
+    int err = file.open(fs, "test", O_WRONLY | O_CREAT);
+    TEST_ASSERT_EQUAL(0, err);
+    srand(1);
+    for (int i = 0; i < file_size; i += file_chunk) {
+        for (int j = 0; j < file_chunk; j++) {
+            buffer[j] = 0xff & rand();
+        }
+        TEST_ASSERT_EQUAL(file_chunk, file.write(buffer, file_chunk));
+    }
+    err = file.close();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = file.open(fs, "test", O_RDONLY);
+    TEST_ASSERT_EQUAL(0, err);
+    srand(1);
+    for (int i = 0; i < file_size; i += file_chunk) {
+        TEST_ASSERT_EQUAL(file_chunk, file.read(buffer, file_chunk));
+        for (int j = 0; j < file_chunk; j++) {
+            TEST_ASSERT_EQUAL(0xff & rand(), buffer[j]);
+        }
+    }
+    err = file.close();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = fs->remove("test");
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+template <bool cached>
+void test_littlefs_workload()
+{
+    HeapBlockDevice heap_bd(num_blocks * erase_size, read_size, prog_size, erase_size);
+    OpCountingBlockDevice profiler(&heap_bd);
+    CachingBlockDevice cache(&profiler, 4);
+    BlockDevice *bd = cached ? static_cast<BlockDevice *>(&cache) : &profiler;
+
+    int err = LittleFileSystem::format(bd, read_size, prog_size, erase_size);
+    TEST_ASSERT_EQUAL(0, err);
+
+    LittleFileSystem fs("fs");
+    err = fs.mount(bd);
+    TEST_ASSERT_EQUAL(0, err);
+    profiler.reset();
+    profiler.reads = profiler.programs = profiler.erases = 0;
+
+    file_workload(&fs);
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+
+    printf("littlefs%s: %lu reads (%llu bytes), %lu programs (%llu bytes), %lu erases\n",
+           cached ? " (cached)" : "",
+           profiler.reads, profiler.get_read_count(),
+           profiler.programs, profiler.get_program_count(), profiler.erases);
+}
+
+template <bool cached>
+void test_fat_workload()
+{
+    HeapBlockDevice heap_bd(128 * erase_size, erase_size);
+    OpCountingBlockDevice profiler(&heap_bd);
+    CachingBlockDevice cache(&profiler, 4, 4 * erase_size);
+    BlockDevice *bd = cached ? static_cast<BlockDevice *>(&cache) : &profiler;
+
+    int err = FATFileSystem::format(bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    FATFileSystem fs("fs");
+    err = fs.mount(bd);
+    TEST_ASSERT_EQUAL(0, err);
+    profiler.reset();
+    profiler.reads = profiler.programs = profiler.erases = 0;
+
+    file_workload(&fs);
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+
+    printf("fatfs%s: %lu reads (%llu bytes), %lu programs (%llu bytes), %lu erases\n",
+           cached ? " (cached)" : "",
+           profiler.reads, profiler.get_read_count(),
+           profiler.programs, profiler.get_program_count(), profiler.erases);
+}
+
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("CachingBlockDevice functionality test", test_caching),
+    Case("LittleFileSystem workload", test_littlefs_workload<false>),
+    Case("LittleFileSystem workload (cached)", test_littlefs_workload<true>),
+    Case("FATFileSystem workload", test_fat_workload<false>),
+    Case("FATFileSystem workload (cached)", test_fat_workload<true>),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
@@ -20,6 +20,8 @@
 
 #include "HeapBlockDevice.h"
 #include "FATFileSystem.h"
+#include "FlashSimBlockDevice.h"
+#include "ProfilingBlockDevice.h"
 #include <stdlib.h>
 #include "mbed_retarget.h"
 
@@ -145,6 +147,122 @@ void test_read_dir() {
     TEST_ASSERT_EQUAL(0, err);
 }
 
+// Write benchmark on flash, blank sectors should not need to be erased
+template <bool RANDOM>
+void test_write_erases() {
+    HeapBlockDevice heap_bd(128*BLOCK_SIZE, BLOCK_SIZE);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    ProfilingBlockDevice profiler(&flash_bd);
+    const int file_size = 32*BLOCK_SIZE;
+    uint8_t buffer[BLOCK_SIZE];
+
+    int err = profiler.init();
+    TEST_ASSERT_EQUAL(0, err);
+    err = profiler.erase(0, profiler.size());
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = FATFileSystem::format(&profiler);
+    TEST_ASSERT_EQUAL(0, err);
+
+    FATFileSystem fs("fat");
+    err = fs.mount(&profiler);
+    TEST_ASSERT_EQUAL(0, err);
+    profiler.reset();
+
+    File file;
+    err = file.open(&fs, "test_write_erases.dat", O_WRONLY | O_CREAT);
+    TEST_ASSERT_EQUAL(0, err);
+
+    srand(1);
+    for (int i = 0; i < file_size / BLOCK_SIZE; i++) {
+        for (int j = 0; j < BLOCK_SIZE; j++) {
+            buffer[j] = 0xff & rand();
+        }
+
+        if (RANDOM) {
+            // Writes at random offsets, growing the file with holes
+            off_t off = BLOCK_SIZE*(rand() % (file_size / BLOCK_SIZE));
+            TEST_ASSERT_EQUAL(off, file.seek(off, SEEK_SET));
+        }
+
+        ssize_t size = file.write(buffer, BLOCK_SIZE);
+        TEST_ASSERT_EQUAL(BLOCK_SIZE, size);
+    }
+
+    err = file.close();
+    TEST_ASSERT_EQUAL(0, err);
+
+    printf("%s writes: programmed %llu bytes, erased %llu bytes\n",
+            RANDOM ? "random" : "sequential",
+            profiler.get_program_count(), profiler.get_erase_count());
+    if (!RANDOM) {
+        TEST_ASSERT(profiler.get_erase_count() < profiler.get_program_count());
+    }
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = profiler.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+// Seek benchmark on growing files, with and without fast seeking
+void test_fast_seek() {
+    HeapBlockDevice heap_bd(1024*BLOCK_SIZE, BLOCK_SIZE);
+    const int seeks = 100;
+    uint8_t buffer[BLOCK_SIZE];
+    memset(buffer, 0xa5, BLOCK_SIZE);
+
+    // Small clusters make long FAT chains
+    int err = FATFileSystem::format(&heap_bd, BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+
+    FATFileSystem fs("fat");
+    err = fs.mount(&heap_bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    int size = 0;
+    for (int blocks = 32; blocks <= 512; blocks *= 4) {
+        File file;
+        err = file.open(&fs, "test_fast_seek.dat", O_WRONLY | O_CREAT);
+        TEST_ASSERT_EQUAL(0, err);
+        TEST_ASSERT_EQUAL(size, file.seek(0, SEEK_END));
+        for (; size < blocks*BLOCK_SIZE; size += BLOCK_SIZE) {
+            TEST_ASSERT_EQUAL(BLOCK_SIZE, file.write(buffer, BLOCK_SIZE));
+        }
+        err = file.close();
+        TEST_ASSERT_EQUAL(0, err);
+
+        int us[2];
+        for (int fast = 0; fast < 2; fast++) {
+            fs.set_fast_seek(fast);
+            err = file.open(&fs, "test_fast_seek.dat", O_RDONLY);
+            TEST_ASSERT_EQUAL(0, err);
+
+            Timer timer;
+            timer.start();
+            srand(1);
+            for (int i = 0; i < seeks; i++) {
+                off_t off = rand() % size;
+                TEST_ASSERT_EQUAL(off, file.seek(off, SEEK_SET));
+                TEST_ASSERT_EQUAL(1, file.read(buffer, 1));
+                TEST_ASSERT_EQUAL(0xa5, buffer[0]);
+            }
+            us[fast] = timer.read_us();
+
+            err = file.close();
+            TEST_ASSERT_EQUAL(0, err);
+        }
+
+        printf("%d byte file: %d us per seek, %d us with fast seek\n",
+                size, us[0] / seeks, us[1] / seeks);
+    }
+    fs.set_fast_seek(false);
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
 
 // Test setup
 utest::v1::status_t test_setup(const size_t number_of_cases) {
@@ -157,6 +275,9 @@ Case cases[] = {
     Case("Testing read write < block", test_read_write<BLOCK_SIZE/2>),
     Case("Testing read write > block", test_read_write<2*BLOCK_SIZE>),
     Case("Testing dir iteration", test_read_dir),
+    Case("Testing sequential write erases", test_write_erases<false>),
+    Case("Testing random write erases", test_write_erases<true>),
+    Case("Testing fast seek", test_fast_seek),
 };
 
 Specification specification(test_setup, cases);
@@ -0,0 +1,391 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed.h"
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#include "HeapBlockDevice.h"
+#include "FlashSimBlockDevice.h"
+#include "ProfilingBlockDevice.h"
+#include "FlashTranslationBlockDevice.h"
+#include "FATFileSystem.h"
+#include <stdlib.h>
+
+using namespace utest::v1;
+
+#ifndef MBED_EXTENDED_TESTS
+    #error [NOT_SUPPORTED] Filesystem tests not supported by default
+#endif
+
+static const bd_size_t read_size = 1;
+static const bd_size_t prog_size = 8;
+static const bd_size_t erase_size = 4096;
+static const bd_size_t num_blocks = 64;
+static const bd_size_t page_size = 512;
+static const bd_size_t num_pages = 64;
+static const int hot_pages = 8;
+static const int rewrites = 4000;
+
+// Random programs, erases and reads compared against a copy, on simulated flash
+void test_functionality()
+{
+    HeapBlockDevice heap_bd(num_blocks * erase_size, read_size, prog_size, erase_size);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    FlashTranslationBlockDevice bd(&flash_bd, page_size);
+    uint8_t *ref = new uint8_t[num_pages * page_size];
+    bool mapped[num_pages] = {false};
+    uint8_t buffer[page_size];
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT(bd.size() >= num_pages * page_size);
+    TEST_ASSERT_EQUAL(page_size, bd.get_program_size());
+    TEST_ASSERT_EQUAL(page_size, bd.get_erase_size());
+
+    srand(1);
+    for (int i = 0; i < 4000; i++) {
+        // Most programs hit a few pages, like file system metadata
+        int page = (rand() % 4) ? rand() % hot_pages : rand() % num_pages;
+
+        switch (rand() % 8) {
+            case 0:
+                err = bd.erase(page * page_size, page_size);
+                TEST_ASSERT_EQUAL(0, err);
+                mapped[page] = false;
+                break;
+
+            case 1:
+                err = bd.compact();
+                TEST_ASSERT_EQUAL(0, err);
+                break;
+
+            case 2:
+            case 3:
+                if (mapped[page]) {
+                    err = bd.read(buffer, page * page_size, page_size);
+                    TEST_ASSERT_EQUAL(0, err);
+                    TEST_ASSERT_EQUAL_UINT8_ARRAY(&ref[page * page_size], buffer, page_size);
+                }
+                break;
+
+            default:
+                for (bd_size_t j = 0; j < page_size; j++) {
+                    ref[page * page_size + j] = 0xff & rand();
+                }
+                err = bd.program(&ref[page * page_size], page * page_size, page_size);
+                TEST_ASSERT_EQUAL(0, err);
+                mapped[page] = true;
+                break;
+        }
+    }
+
+    // The mapping is rebuilt from the flash
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+    err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    for (bd_size_t page = 0; page < num_pages; page++) {
+        if (mapped[page]) {
+            err = bd.read(buffer, page * page_size, page_size);
+            TEST_ASSERT_EQUAL(0, err);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(&ref[page * page_size], buffer, page_size);
+        }
+    }
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+    delete[] ref;
+}
+
+static void erase_spread(ProfilingBlockDevice *profiler, uint32_t *min, uint32_t *max)
+{
+    *min = 0xffffffff;
+    *max = 0;
+    for (bd_size_t block = 0; block < num_blocks; block++) {
+        uint32_t count = profiler->get_erase_count(block * erase_size);
+        *min = count < *min ? count : *min;
+        *max = count > *max ? count : *max;
+    }
+}
+
+// Rewrites of a few pages spread over all erase blocks
+void test_wear_levelling()
+{
+    HeapBlockDevice heap_bd(num_blocks * erase_size, read_size, prog_size, erase_size);
+    ProfilingBlockDevice profiler(&heap_bd, true);
+    FlashTranslationBlockDevice bd(&profiler, page_size);
+    uint8_t buffer[page_size];
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    // Cold data filling most of the device
+    memset(buffer, 0xcc, page_size);
+    for (bd_addr_t addr = 0; addr < bd.size() / 2; addr += page_size) {
+        err = bd.program(buffer, addr, page_size);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    for (int i = 0; i < rewrites; i++) {
+        memset(buffer, i, page_size);
+        err = bd.program(buffer, (i % hot_pages) * page_size, page_size);
+        TEST_ASSERT_EQUAL(0, err);
+        if (i % 64 == 0) {
+            err = bd.compact();
+            TEST_ASSERT_EQUAL(0, err);
+        }
+    }
+
+    uint32_t min, max;
+    erase_spread(&profiler, &min, &max);
+    printf("ftl: %d rewrites of %d pages, erases per block min %lu max %lu\n",
+           rewrites, hot_pages, min, max);
+    // Writing the same pages in place would erase their block on every rewrite
+    TEST_ASSERT(max < rewrites / 8);
+    TEST_ASSERT(max - min <= 2 * 16);
+
+    for (int page = 0; page < hot_pages; page++) {
+        err = bd.read(buffer, page * page_size, page_size);
+        TEST_ASSERT_EQUAL(0, err);
+        TEST_ASSERT_EQUAL(0xff & (rewrites - hot_pages + page), buffer[0]);
+    }
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+// FAT on top of the translation layer survives a remount
+void test_fat()
+{
+    HeapBlockDevice heap_bd(num_blocks * erase_size, read_size, prog_size, erase_size);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    FlashTranslationBlockDevice bd(&flash_bd, page_size);
+
+    int err = FATFileSystem::format(&bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    FATFileSystem fs("fs");
+    err = fs.mount(&bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    File file;
+    for (int i = 0; i < 20; i++) {
+        err = file.open(&fs, "counter", O_WRONLY | O_CREAT | O_TRUNC);
+        TEST_ASSERT_EQUAL(0, err);
+        TEST_ASSERT_EQUAL(sizeof(i), file.write(&i, sizeof(i)));
+        err = file.close();
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+    err = fs.mount(&bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    int value = 0;
+    err = file.open(&fs, "counter", O_RDONLY);
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL(sizeof(value), file.read(&value, sizeof(value)));
+    TEST_ASSERT_EQUAL(19, value);
+    err = file.close();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+// Erases and trims stay in effect over remounts, erased pages don't take
+// space again and run the device out of free segments
+void test_erase_remount()
+{
+    HeapBlockDevice heap_bd(16 * erase_size, read_size, prog_size, erase_size);
+    FlashTranslationBlockDevice bd(&heap_bd, page_size);
+    uint8_t buffer[page_size];
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+    int pages = bd.size() / page_size;
+    uint8_t *ref = new uint8_t[pages * page_size];
+    bool *mapped = new bool[pages]();
+
+    srand(3);
+    for (int i = 0; i < 2000; i++) {
+        int page = rand() % pages;
+
+        switch (rand() % 10) {
+            case 0:
+                err = bd.erase(page * page_size, page_size);
+                TEST_ASSERT_EQUAL(0, err);
+                mapped[page] = false;
+                break;
+
+            case 1:
+                err = bd.trim(page * page_size, page_size);
+                TEST_ASSERT_EQUAL(0, err);
+                mapped[page] = false;
+                break;
+
+            case 2:
+                err = bd.compact();
+                TEST_ASSERT_EQUAL(0, err);
+                break;
+
+            default:
+                for (bd_size_t j = 0; j < page_size; j++) {
+                    ref[page * page_size + j] = 0xff & rand();
+                }
+                err = bd.program(&ref[page * page_size], page * page_size, page_size);
+                TEST_ASSERT_EQUAL(0, err);
+                mapped[page] = true;
+                break;
+        }
+
+        if (i % 20 == 19) {
+            err = bd.deinit();
+            TEST_ASSERT_EQUAL(0, err);
+            err = bd.init();
+            TEST_ASSERT_EQUAL(0, err);
+
+            for (int page = 0; page < pages; page++) {
+                if (mapped[page]) {
+                    err = bd.read(buffer, page * page_size, page_size);
+                    TEST_ASSERT_EQUAL(0, err);
+                    TEST_ASSERT_EQUAL_UINT8_ARRAY(&ref[page * page_size], buffer, page_size);
+                }
+            }
+        }
+    }
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+    delete[] ref;
+    delete[] mapped;
+}
+
+// Storage with no erased value, which loses power after a number of programs
+class PowerLossBlockDevice : public HeapBlockDevice {
+public:
+    PowerLossBlockDevice(bd_size_t size) :
+        HeapBlockDevice(size, read_size, prog_size, erase_size), budget(-1), erases(0)
+    {
+    }
+
+    virtual int program(const void *b, bd_addr_t addr, bd_size_t size)
+    {
+        if (budget == 0) {
+            // Only part of the data makes it
+            HeapBlockDevice::program(b, addr, size / 2 / prog_size * prog_size);
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        if (budget > 0) {
+            budget--;
+        }
+        return HeapBlockDevice::program(b, addr, size);
+    }
+
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        uint8_t buffer[prog_size];
+        erases++;
+        for (bd_size_t i = 0; i < size; i += prog_size) {
+            for (bd_size_t j = 0; j < prog_size; j++) {
+                buffer[j] = 0xff & (7 * (i + j) + erases);
+            }
+            HeapBlockDevice::program(buffer, addr + i, prog_size);
+        }
+        return HeapBlockDevice::erase(addr, size);
+    }
+
+    int budget;
+    int erases;
+};
+
+// Power losses in the middle of programs and compactions, when erased storage
+// can't be told apart from programmed storage
+void test_power_loss()
+{
+    // A small device, so compactions need the segments kept in reserve
+    PowerLossBlockDevice power_bd(8 * erase_size);
+    FlashTranslationBlockDevice bd(&power_bd, page_size);
+    uint8_t *ref = new uint8_t[num_pages * page_size];
+    bool mapped[num_pages] = {false};
+    uint8_t buffer[page_size];
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+    int pages = bd.size() / page_size;
+    TEST_ASSERT(pages <= num_pages);
+
+    srand(2);
+    for (int trial = 0; trial < 200; trial++) {
+        power_bd.budget = rand() % 300;
+        err = 0;
+        while (!err) {
+            int page = (rand() % 4) ? rand() % hot_pages : rand() % pages;
+            for (bd_size_t j = 0; j < page_size; j++) {
+                buffer[j] = 0xff & rand();
+            }
+            err = bd.program(buffer, page * page_size, page_size);
+            if (!err) {
+                memcpy(&ref[page * page_size], buffer, page_size);
+            }
+            // An interrupted program leaves either copy of the page
+            mapped[page] = !err;
+        }
+        power_bd.budget = -1;
+
+        err = bd.deinit();
+        TEST_ASSERT_EQUAL(0, err);
+        err = bd.init();
+        TEST_ASSERT_EQUAL(0, err);
+
+        for (int page = 0; page < pages; page++) {
+            if (mapped[page]) {
+                err = bd.read(buffer, page * page_size, page_size);
+                TEST_ASSERT_EQUAL(0, err);
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(&ref[page * page_size], buffer, page_size);
+            }
+        }
+    }
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+    delete[] ref;
+}
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("FlashTranslationBlockDevice functionality test", test_functionality),
+    Case("FlashTranslationBlockDevice wear levelling", test_wear_levelling),
+    Case("FATFileSystem on FlashTranslationBlockDevice", test_fat),
+    Case("FlashTranslationBlockDevice erase and remount", test_erase_remount),
+    Case("FlashTranslationBlockDevice power loss", test_power_loss),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
@@ -122,6 +122,80 @@ void functionality_test()
     TEST_ASSERT_EQUAL_UINT8_ARRAY(write_buf, read_buf, test_buf_size);
 }
 
+static const uint32_t erase_latency_us = 10000;
+
+static volatile int async_done;
+static volatile int async_err;
+static int async_ids[2 * num_blocks];
+static int async_order[2 * num_blocks];
+
+// Records the order in which operations complete
+static void async_complete(int *id, int err)
+{
+    if (err) {
+        async_err = err;
+    }
+    async_order[async_done++] = *id;
+}
+
+// Queues erases and programs of all blocks before the event queue is dispatched,
+// then checks that they complete on the queue's thread in submission order
+void async_test()
+{
+    HeapBlockDevice heap_bd(num_blocks * erase_size, read_size, prog_size, erase_size);
+    FlashSimBlockDevice bd(&heap_bd, blank);
+    EventQueue queue;
+    Thread thread;
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+    bd.set_latency(0, 0, erase_latency_us);
+
+    uint8_t write_buf[num_blocks][test_buf_size], read_buf[test_buf_size];
+    srand(1);
+    for (bd_size_t b = 0; b < num_blocks; b++) {
+        for (bd_size_t i = 0; i < test_buf_size; i++) {
+            write_buf[b][i] = 0xff & rand();
+        }
+    }
+
+    bd.set_async_queue(&queue);
+    async_done = 0;
+    async_err = 0;
+
+    for (bd_size_t b = 0; b < num_blocks; b++) {
+        async_ids[2 * b] = 2 * b;
+        err = bd.erase_async(b * erase_size, erase_size, callback(async_complete, &async_ids[2 * b]));
+        TEST_ASSERT_EQUAL(0, err);
+        async_ids[2 * b + 1] = 2 * b + 1;
+        err = bd.program_async(write_buf[b], b * erase_size, test_buf_size,
+                               callback(async_complete, &async_ids[2 * b + 1]));
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    // Nothing completes until the queue is dispatched
+    TEST_ASSERT_EQUAL(0, async_done);
+
+    thread.start(callback(&queue, &EventQueue::dispatch_forever));
+    while (async_done < 2 * num_blocks) {
+        Thread::wait(1);
+    }
+    TEST_ASSERT_EQUAL(0, async_err);
+    for (bd_size_t i = 0; i < 2 * num_blocks; i++) {
+        TEST_ASSERT_EQUAL(i, async_order[i]);
+    }
+
+    for (bd_size_t b = 0; b < num_blocks; b++) {
+        err = bd.read(read_buf, b * erase_size, test_buf_size);
+        TEST_ASSERT_EQUAL(0, err);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(write_buf[b], read_buf, test_buf_size);
+    }
+
+    bd.set_async_queue(NULL);
+    queue.break_dispatch();
+    thread.join();
+}
+
 
 // Test setup
 utest::v1::status_t test_setup(const size_t number_of_cases)
@@ -132,6 +206,7 @@ utest::v1::status_t test_setup(const size_t number_of_cases)
 
 Case cases[] = {
     Case("FlashSimBlockDevice functionality test", functionality_test),
+    Case("FlashSimBlockDevice async test", async_test),
 };
 
 Specification specification(test_setup, cases);
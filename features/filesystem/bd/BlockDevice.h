@@ -18,6 +18,7 @@
 #define MBED_BLOCK_DEVICE_H
 
 #include <stdint.h>
+#include "Callback.h"
 
 
 /** Enum of standard error codes
@@ -37,6 +38,11 @@ typedef uint64_t bd_addr_t;
  */
 typedef uint64_t bd_size_t;
 
+/** Type of the callback completing an asynchronous operation, called with
+ *  0 on success or a negative error code on failure
+ */
+typedef mbed::Callback<void(int)> bd_callback_t;
+
 
 /** A hardware device capable of writing and reading blocks
  */
@@ -122,6 +128,61 @@ public:
         return 0;
     }
 
+    /** Submit an asynchronous read of blocks from a block device
+     *
+     *  The buffer must stay valid until the callback is called. Requests are
+     *  completed in the order they are submitted. Block devices without
+     *  asynchronous support complete the read before returning, calling the
+     *  callback from this function.
+     *
+     *  @param buffer   Buffer to write blocks to
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @param cb       Callback called with the result of the read
+     *  @return         0 if the read was submitted, negative error code on failure
+     */
+    virtual int read_async(void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+    {
+        cb(read(buffer, addr, size));
+        return 0;
+    }
+
+    /** Submit an asynchronous program of blocks to a block device
+     *
+     *  The buffer must stay valid until the callback is called. Requests are
+     *  completed in the order they are submitted. Block devices without
+     *  asynchronous support complete the program before returning, calling the
+     *  callback from this function.
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @param cb       Callback called with the result of the program
+     *  @return         0 if the program was submitted, negative error code on failure
+     */
+    virtual int program_async(const void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+    {
+        cb(program(buffer, addr, size));
+        return 0;
+    }
+
+    /** Submit an asynchronous erase of blocks on a block device
+     *
+     *  Requests are completed in the order they are submitted. Block devices
+     *  without asynchronous support complete the erase before returning, calling
+     *  the callback from this function.
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @param cb       Callback called with the result of the erase
+     *  @return         0 if the erase was submitted, negative error code on failure
+     */
+    virtual int erase_async(bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+    {
+        cb(erase(addr, size));
+        return 0;
+    }
+
     /** Get the size of a readable block
      *
      *  @return         Size of a readable block in bytes
@@ -0,0 +1,381 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CachingBlockDevice.h"
+#include "mbed_assert.h"
+#include <algorithm>
+#include <string.h>
+
+CachingBlockDevice::CachingBlockDevice(BlockDevice *bd, uint32_t line_count, bd_size_t line_size) :
+    _bd(bd), _line_count(line_count), _line_size(line_size),
+    _lines(0), _cache(0), _use_count(0)
+{
+    MBED_ASSERT(line_count > 0);
+}
+
+CachingBlockDevice::~CachingBlockDevice()
+{
+    delete[] _lines;
+    delete[] _cache;
+}
+
+int CachingBlockDevice::init()
+{
+    int err = _bd->init();
+    if (err) {
+        return err;
+    }
+
+    if (!_line_size) {
+        _line_size = _bd->get_erase_size();
+    }
+    MBED_ASSERT(_line_size % _bd->get_program_size() == 0);
+    MBED_ASSERT(_line_size % _bd->get_read_size() == 0);
+
+    if (!_lines) {
+        _lines = new cache_line[_line_count];
+        _cache = new uint8_t[_line_count * _line_size];
+        MBED_ASSERT(_lines && _cache);
+    }
+
+    for (uint32_t i = 0; i < _line_count; i++) {
+        _lines[i].buffer = _cache + i * _line_size;
+        _lines[i].used = false;
+        _lines[i].valid = false;
+        _lines[i].dirty_start = 0;
+        _lines[i].dirty_end = 0;
+        _lines[i].last_use = 0;
+    }
+
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::deinit()
+{
+    int err = sync();
+    if (err) {
+        return err;
+    }
+
+    delete[] _lines;
+    delete[] _cache;
+    _lines = 0;
+    _cache = 0;
+
+    return _bd->deinit();
+}
+
+int CachingBlockDevice::sync()
+{
+    // Nothing is cached before init or after deinit
+    if (!_lines) {
+        return _bd->sync();
+    }
+
+    for (uint32_t i = 0; i < _line_count; i++) {
+        int err = flush_line(&_lines[i]);
+        if (err) {
+            return err;
+        }
+    }
+
+    return _bd->sync();
+}
+
+CachingBlockDevice::cache_line *CachingBlockDevice::find_line(bd_addr_t line_addr)
+{
+    for (uint32_t i = 0; i < _line_count; i++) {
+        if (_lines[i].used && _lines[i].addr == line_addr) {
+            return &_lines[i];
+        }
+    }
+    return 0;
+}
+
+CachingBlockDevice::cache_line *CachingBlockDevice::alloc_line(bd_addr_t line_addr, int &err)
+{
+    // Take an unused line, or evict the least recently used one
+    cache_line *line = &_lines[0];
+    for (uint32_t i = 0; i < _line_count; i++) {
+        if (!_lines[i].used) {
+            line = &_lines[i];
+            break;
+        }
+        if (_lines[i].last_use < line->last_use) {
+            line = &_lines[i];
+        }
+    }
+
+    err = flush_line(line);
+    if (err) {
+        return 0;
+    }
+
+    line->addr = line_addr;
+    line->used = true;
+    line->valid = false;
+    line->last_use = ++_use_count;
+    return line;
+}
+
+int CachingBlockDevice::flush_line(cache_line *line)
+{
+    if (!line->used || line->dirty_end == line->dirty_start) {
+        return BD_ERROR_OK;
+    }
+
+    int err = _bd->program(line->buffer + line->dirty_start, line->addr + line->dirty_start,
+                           line->dirty_end - line->dirty_start);
+    if (err) {
+        return err;
+    }
+
+    line->dirty_start = 0;
+    line->dirty_end = 0;
+    return BD_ERROR_OK;
+}
+
+bool CachingBlockDevice::cached(bd_addr_t addr, bd_size_t size)
+{
+    for (uint32_t i = 0; i < _line_count; i++) {
+        if (_lines[i].used && (_lines[i].addr < addr + size) && (_lines[i].addr + _line_size > addr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bd_size_t CachingBlockDevice::full_line_run(bd_addr_t addr, bd_size_t size)
+{
+    bd_size_t run = 0;
+    while ((size - run >= _line_size) && !find_line(addr + run)) {
+        run += _line_size;
+    }
+    return run;
+}
+
+int CachingBlockDevice::invalidate(bd_addr_t addr, bd_size_t size, bool erased)
+{
+    int erase_value = _bd->get_erase_value();
+
+    for (uint32_t i = 0; i < _line_count; i++) {
+        cache_line *line = &_lines[i];
+        if (!line->used || (line->addr >= addr + size) || (line->addr + _line_size <= addr)) {
+            continue;
+        }
+
+        bd_size_t start = std::max(addr, line->addr) - line->addr;
+        bd_size_t end = std::min(addr + size, line->addr + _line_size) - line->addr;
+
+        // Buffered data in the region is discarded, the rest has to reach the device first
+        if ((line->dirty_start >= start) && (line->dirty_end <= end)) {
+            line->dirty_start = 0;
+            line->dirty_end = 0;
+        } else {
+            int err = flush_line(line);
+            if (err) {
+                return err;
+            }
+        }
+
+        if (line->valid && erased && (erase_value >= 0)) {
+            memset(line->buffer + start, erase_value, end - start);
+        } else {
+            line->valid = false;
+            line->used = false;
+        }
+    }
+
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_read(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    // Reads spanning several lines, none of them cached, take a single direct read
+    if ((addr % _line_size + size > _line_size) && !cached(addr, size)) {
+        return _bd->read(b, addr, size);
+    }
+
+    uint8_t *buffer = static_cast<uint8_t *>(b);
+    while (size > 0) {
+        bd_addr_t line_addr = addr - addr % _line_size;
+        bd_size_t offset = addr - line_addr;
+        bd_size_t chunk = std::min(size, _line_size - offset);
+
+        cache_line *line = find_line(line_addr);
+        if (!line && (offset == 0) && (chunk == _line_size)) {
+            // Whole uncached lines are read directly, together with the following ones
+            bd_size_t run = full_line_run(addr, size);
+            int err = _bd->read(buffer, addr, run);
+            if (err) {
+                return err;
+            }
+            buffer += run;
+            addr += run;
+            size -= run;
+            continue;
+        }
+
+        bool hit = line && (line->valid ||
+                            ((offset >= line->dirty_start) && (offset + chunk <= line->dirty_end)));
+        if (!hit) {
+            // Fill the whole line, serving following reads of it from the cache
+            int err;
+            if (line) {
+                err = flush_line(line);
+            } else {
+                line = alloc_line(line_addr, err);
+            }
+            if (err) {
+                return err;
+            }
+
+            err = _bd->read(line->buffer, line_addr, std::min(_line_size, this->size() - line_addr));
+            if (err) {
+                line->used = false;
+                return err;
+            }
+            line->valid = true;
+        }
+
+        memcpy(buffer, line->buffer + offset, chunk);
+        line->last_use = ++_use_count;
+
+        buffer += chunk;
+        addr += chunk;
+        size -= chunk;
+    }
+
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_program(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    const uint8_t *buffer = static_cast<const uint8_t *>(b);
+    while (size > 0) {
+        bd_addr_t line_addr = addr - addr % _line_size;
+        bd_size_t offset = addr - line_addr;
+        bd_size_t chunk = std::min(size, _line_size - offset);
+
+        int err = BD_ERROR_OK;
+        cache_line *line = find_line(line_addr);
+        if (!line && (offset == 0) && (chunk == _line_size)) {
+            // Nothing to coalesce with whole uncached lines, program them directly
+            bd_size_t run = full_line_run(addr, size);
+            err = _bd->program(buffer, addr, run);
+            if (err) {
+                return err;
+            }
+            buffer += run;
+            addr += run;
+            size -= run;
+            continue;
+        }
+
+        if (!line) {
+            line = alloc_line(line_addr, err);
+        } else if ((line->dirty_end != line->dirty_start) &&
+                   (offset != line->dirty_end) && (offset + chunk != line->dirty_start)) {
+            // Only contiguous programs are coalesced
+            err = flush_line(line);
+        }
+        if (err) {
+            return err;
+        }
+
+        memcpy(line->buffer + offset, buffer, chunk);
+        if (line->dirty_end == line->dirty_start) {
+            line->dirty_start = offset;
+            line->dirty_end = offset + chunk;
+        } else {
+            line->dirty_start = std::min(line->dirty_start, offset);
+            line->dirty_end = std::max(line->dirty_end, offset + chunk);
+        }
+        line->last_use = ++_use_count;
+
+        buffer += chunk;
+        addr += chunk;
+        size -= chunk;
+    }
+
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_erase(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int err = invalidate(addr, size, true);
+    if (err) {
+        return err;
+    }
+
+    err = _bd->erase(addr, size);
+    if (err) {
+        invalidate(addr, size, false);
+    }
+    return err;
+}
+
+int CachingBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    int err = invalidate(addr, size, false);
+    if (err) {
+        return err;
+    }
+
+    return _bd->trim(addr, size);
+}
+
+bd_size_t CachingBlockDevice::get_read_size() const
+{
+    return _bd->get_read_size();
+}
+
+bd_size_t CachingBlockDevice::get_program_size() const
+{
+    return _bd->get_program_size();
+}
+
+bd_size_t CachingBlockDevice::get_erase_size() const
+{
+    return _bd->get_erase_size();
+}
+
+bd_size_t CachingBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _bd->get_erase_size(addr);
+}
+
+int CachingBlockDevice::get_erase_value() const
+{
+    return _bd->get_erase_value();
+}
+
+bd_size_t CachingBlockDevice::size() const
+{
+    return _bd->size();
+}
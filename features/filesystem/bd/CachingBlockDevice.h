@@ -0,0 +1,188 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_CACHING_BLOCK_DEVICE_H
+#define MBED_CACHING_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+
+/** Block device for caching reads and coalescing programs of another block device
+ *
+ *  Keeps an LRU of cache lines (erase block sized by default). A read miss fills
+ *  a whole line with a single read of the underlying device, so following reads
+ *  from the same line (small file system metadata reads or sequential reads) are
+ *  served from RAM. Contiguous programs within a line are buffered and written to
+ *  the underlying device as a single program, when the line is evicted, read back
+ *  or erased, or on sync.
+ *  Accesses covering whole lines, or reads spanning several lines, which aren't
+ *  cached go directly to the underlying device.
+ *
+ *  @note Buffered programs are lost on power failure unless sync is called, like
+ *        any write-back cache. File systems call sync when they need data to be
+ *        committed.
+ *
+ *  @code
+ *  #include "mbed.h"
+ *  #include "HeapBlockDevice.h"
+ *  #include "CachingBlockDevice.h"
+ *
+ *  HeapBlockDevice mem(64*512, 512);
+ *  CachingBlockDevice cache(&mem, 4);    // 4 cache lines of 512 bytes
+ *  @endcode
+ */
+class CachingBlockDevice : public BlockDevice
+{
+public:
+    /** Lifetime of the caching block device
+     *
+     *  @param bd           Block device to back the CachingBlockDevice
+     *  @param line_count   Number of cache lines
+     *  @param line_size    Size of a cache line in bytes, 0 for the erase size of the
+     *                      underlying device. Must be a multiple of its program size.
+     */
+    CachingBlockDevice(BlockDevice *bd, uint32_t line_count = 4, bd_size_t line_size = 0);
+
+    /** Lifetime of a block device
+     */
+    virtual ~CachingBlockDevice();
+
+    /** Initialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  Programs all buffered data to the underlying device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  The blocks must have been erased prior to being programmed
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  The state of an erased block is undefined until it has been programmed,
+     *  unless get_erase_value returns a non-negative byte value
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Mark blocks as no longer in use
+     *
+     *  @param addr     Address of block to mark as unused
+     *  @param size     Size to mark as unused in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int trim(bd_addr_t addr, bd_size_t size);
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  @return         The value of storage when erased, or -1 if you can't
+     *                  rely on the value of erased storage
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the underlying device
+     *
+     *  @return         Size of the underlying device in bytes
+     */
+    virtual bd_size_t size() const;
+
+private:
+    struct cache_line {
+        bd_addr_t addr;
+        uint8_t *buffer;
+        bool used;
+        bool valid;
+        bd_size_t dirty_start;
+        bd_size_t dirty_end;
+        uint32_t last_use;
+    };
+
+    cache_line *find_line(bd_addr_t line_addr);
+    cache_line *alloc_line(bd_addr_t line_addr, int &err);
+    int flush_line(cache_line *line);
+    bool cached(bd_addr_t addr, bd_size_t size);
+    bd_size_t full_line_run(bd_addr_t addr, bd_size_t size);
+    int invalidate(bd_addr_t addr, bd_size_t size, bool erased);
+
+    BlockDevice *_bd;
+    uint32_t _line_count;
+    bd_size_t _line_size;
+    cache_line *_lines;
+    uint8_t *_cache;
+    uint32_t _use_count;
+};
+
+
+#endif
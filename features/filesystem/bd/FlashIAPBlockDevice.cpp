@@ -0,0 +1,113 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FlashIAPBlockDevice.h"
+
+#ifdef DEVICE_FLASH
+
+FlashIAPBlockDevice::FlashIAPBlockDevice(uint32_t address, uint32_t size) :
+    _base(address), _size(0), _requested_size(size)
+{
+}
+
+FlashIAPBlockDevice::~FlashIAPBlockDevice()
+{
+}
+
+int FlashIAPBlockDevice::init()
+{
+    int err = _flash.init();
+    if (err) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    uint32_t flash_end = _flash.get_flash_start() + _flash.get_flash_size();
+    _size = _requested_size ? _requested_size : flash_end - _base;
+    if ((_base < _flash.get_flash_start()) || (_base + _size > flash_end) ||
+            (_base % _flash.get_sector_size(_base))) {
+        _flash.deinit();
+        _size = 0;
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return BD_ERROR_OK;
+}
+
+int FlashIAPBlockDevice::deinit()
+{
+    _size = 0;
+    return _flash.deinit() ? BD_ERROR_DEVICE_ERROR : BD_ERROR_OK;
+}
+
+int FlashIAPBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_read(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return _flash.read(buffer, _base + addr, size) ? BD_ERROR_DEVICE_ERROR : BD_ERROR_OK;
+}
+
+int FlashIAPBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_program(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return _flash.program(buffer, _base + addr, size) ? BD_ERROR_DEVICE_ERROR : BD_ERROR_OK;
+}
+
+int FlashIAPBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    // Sectors may have different sizes, FlashIAP checks the alignment
+    if (addr + size > _size) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return _flash.erase(_base + addr, size) ? BD_ERROR_DEVICE_ERROR : BD_ERROR_OK;
+}
+
+bd_size_t FlashIAPBlockDevice::get_read_size() const
+{
+    return 1;
+}
+
+bd_size_t FlashIAPBlockDevice::get_program_size() const
+{
+    return _flash.get_page_size();
+}
+
+bd_size_t FlashIAPBlockDevice::get_erase_size() const
+{
+    return _flash.get_sector_size(_base);
+}
+
+bd_size_t FlashIAPBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _flash.get_sector_size(_base + addr);
+}
+
+int FlashIAPBlockDevice::get_erase_value() const
+{
+    return -1;
+}
+
+bd_size_t FlashIAPBlockDevice::size() const
+{
+    return _size;
+}
+
+#endif /* DEVICE_FLASH */
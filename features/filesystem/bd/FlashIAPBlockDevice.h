@@ -0,0 +1,145 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_FLASHIAP_BLOCK_DEVICE_H
+#define MBED_FLASHIAP_BLOCK_DEVICE_H
+
+#if defined(DEVICE_FLASH) || defined(DOXYGEN_ONLY)
+
+#include "BlockDevice.h"
+#include "drivers/FlashIAP.h"
+
+/** Block device for a region of the internal flash, through FlashIAP
+ *
+ *  The region must not overlap the application. Internal flash sectors may
+ *  have different sizes, and erase them a limited number of times; stack a
+ *  FlashTranslationBlockDevice on top of a region of uniform sectors for
+ *  file systems which rewrite the same sectors.
+ *
+ *  @code
+ *  #include "mbed.h"
+ *  #include "FlashIAPBlockDevice.h"
+ *
+ *  // The last 256KB of a 1MB flash starting at 0
+ *  FlashIAPBlockDevice flash(0xC0000, 0x40000);
+ *  @endcode
+ */
+class FlashIAPBlockDevice : public BlockDevice
+{
+public:
+    /** Lifetime of the FlashIAP block device
+     *
+     *  @param address  Address of the start of the region in flash, must be
+     *                  aligned to a sector
+     *  @param size     Size of the region in bytes, 0 for the rest of the flash
+     */
+    FlashIAPBlockDevice(uint32_t address, uint32_t size = 0);
+
+    /** Lifetime of a block device
+     */
+    virtual ~FlashIAPBlockDevice();
+
+    /** Initialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  The blocks must have been erased prior to being programmed
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  The state of an erased block is undefined until it has been programmed
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of the first erasable block of the region in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  @return         -1, FlashIAP doesn't report the erased value
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the region
+     *
+     *  @return         Size of the region in bytes
+     */
+    virtual bd_size_t size() const;
+
+private:
+    mbed::FlashIAP _flash;
+    uint32_t _base;
+    uint32_t _size;
+    uint32_t _requested_size;
+};
+
+#endif /* DEVICE_FLASH */
+
+#endif
@@ -16,7 +16,9 @@
 
 #include "FlashSimBlockDevice.h"
 #include "mbed_assert.h"
+#include "mbed_wait_api.h"
 #include <algorithm>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -29,7 +31,8 @@ static inline uint32_t align_up(bd_size_t val, bd_size_t size)
 
 FlashSimBlockDevice::FlashSimBlockDevice(BlockDevice *bd, uint8_t erase_value) :
     _erase_value(erase_value), _blank_buf_size(0),
-    _blank_buf(0), _bd(bd)
+    _blank_buf(0), _bd(bd),
+    _read_latency(0), _program_latency(0), _erase_latency(0), _queue(0)
 {
 }
 
@@ -90,12 +93,19 @@ bd_size_t FlashSimBlockDevice::size() const
 
 int FlashSimBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
 {
+    if (_read_latency) {
+        wait_us(_read_latency);
+    }
     return _bd->read(b, addr, size);
 }
 
 int FlashSimBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
 {
     MBED_ASSERT(is_valid_program(addr, size));
+    if (_program_latency) {
+        wait_us(_program_latency);
+    }
+
     bd_addr_t curr_addr = addr;
     bd_size_t curr_size = size;
 
@@ -124,6 +134,12 @@ int FlashSimBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
 int FlashSimBlockDevice::erase(bd_addr_t addr, bd_size_t size)
 {
     MBED_ASSERT(is_valid_erase(addr, size));
+    // Wait block by block, as the total may not fit in wait_us's argument
+    if (_erase_latency) {
+        for (bd_size_t i = 0; i < size / _bd->get_erase_size(); i++) {
+            wait_us(_erase_latency);
+        }
+    }
 
     bd_addr_t curr_addr = addr;
     bd_size_t curr_size = size;
@@ -147,3 +163,67 @@ int FlashSimBlockDevice::get_erase_value() const
 {
     return _erase_value;
 }
+
+void FlashSimBlockDevice::set_latency(uint32_t read_us, uint32_t program_us, uint32_t erase_us)
+{
+    // wait_us takes an int
+    _read_latency = std::min(read_us, (uint32_t) INT_MAX);
+    _program_latency = std::min(program_us, (uint32_t) INT_MAX);
+    _erase_latency = std::min(erase_us, (uint32_t) INT_MAX);
+}
+
+void FlashSimBlockDevice::set_async_queue(events::EventQueue *queue)
+{
+    _queue = queue;
+}
+
+int FlashSimBlockDevice::read_async(void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    if (!_queue) {
+        return BlockDevice::read_async(buffer, addr, size, cb);
+    }
+
+    if (!_queue->call(this, &FlashSimBlockDevice::complete_read, buffer, addr, size, cb)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+int FlashSimBlockDevice::program_async(const void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    if (!_queue) {
+        return BlockDevice::program_async(buffer, addr, size, cb);
+    }
+
+    if (!_queue->call(this, &FlashSimBlockDevice::complete_program, buffer, addr, size, cb)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+int FlashSimBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    if (!_queue) {
+        return BlockDevice::erase_async(addr, size, cb);
+    }
+
+    if (!_queue->call(this, &FlashSimBlockDevice::complete_erase, addr, size, cb)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+void FlashSimBlockDevice::complete_read(void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    cb(read(buffer, addr, size));
+}
+
+void FlashSimBlockDevice::complete_program(const void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    cb(program(buffer, addr, size));
+}
+
+void FlashSimBlockDevice::complete_erase(bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    cb(erase(addr, size));
+}
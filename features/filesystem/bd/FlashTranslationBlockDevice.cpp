@@ -0,0 +1,626 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FlashTranslationBlockDevice.h"
+#include "drivers/MbedCRC.h"
+#include <stddef.h>
+#include <string.h>
+
+#define FTL_MAGIC 0x46544c31    // "FTL1"
+
+static const uint32_t NO_SLOT = 0xffffffff;
+static const uint32_t NO_SEGMENT = 0xffffffff;
+static const uint32_t NO_VALUE = 0xffffffff;
+
+// Set in the page of tags which unmap the page, and in map entries pointing at them
+static const uint32_t UNMAPPED = 0x80000000;
+
+// On-storage headers, each padded to a program unit
+struct ftl_header {
+    uint32_t magic;
+    uint32_t erase_count;
+    uint32_t page_size;
+    uint32_t erased;
+    uint32_t crc;
+};
+
+struct ftl_tag {
+    uint32_t page;
+    uint32_t seq;
+    uint32_t crc;
+};
+
+static uint32_t ftl_crc(const void *buffer, bd_size_t size)
+{
+    mbed::MbedCRC<mbed::POLY_32BIT_ANSI, 32> ct;
+    uint32_t crc = 0;
+    ct.compute(const_cast<void *>(buffer), size, &crc);
+    return crc;
+}
+
+FlashTranslationBlockDevice::FlashTranslationBlockDevice(BlockDevice *bd, bd_size_t page_size,
+                                                         uint32_t wear_threshold) :
+    _bd(bd), _page_size(page_size), _wear_threshold(wear_threshold),
+    _segment_size(0), _tag_size(0), _segment_count(0), _slots(0), _pages(0),
+    _map(0), _segments(0), _buffer(0),
+    _active(NO_SEGMENT), _free_count(0), _seq(0), _compacting(false)
+{
+}
+
+FlashTranslationBlockDevice::~FlashTranslationBlockDevice()
+{
+    delete[] _map;
+    delete[] _segments;
+    delete[] _buffer;
+}
+
+int FlashTranslationBlockDevice::init()
+{
+    _mutex.lock();
+    int err = init_ftl();
+    _mutex.unlock();
+    return err;
+}
+
+int FlashTranslationBlockDevice::init_ftl()
+{
+    int err = _bd->init();
+    if (err) {
+        return err;
+    }
+
+    // Headers and tags take a program unit each
+    bd_size_t program_size = _bd->get_program_size();
+    bd_size_t tag_size = sizeof(ftl_header) > program_size ? sizeof(ftl_header) : program_size;
+    _tag_size = (tag_size + program_size - 1) / program_size * program_size;
+    _segment_size = _bd->get_erase_size();
+    _segment_count = _bd->size() / _segment_size;
+
+    if ((_page_size % program_size) || (_page_size % _bd->get_read_size()) ||
+            (_segment_count < 3) || (_segment_size < 2 * _tag_size + _page_size)) {
+        _bd->deinit();
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _slots = (_segment_size - _tag_size) / (_tag_size + _page_size);
+    _pages = (_segment_count - 2) * _slots;
+
+    if (!_map) {
+        _map = new uint32_t[_pages];
+        _segments = new segment[_segment_count];
+        _buffer = new uint8_t[_page_size + _tag_size];
+    }
+
+    return scan();
+}
+
+int FlashTranslationBlockDevice::deinit()
+{
+    _mutex.lock();
+    delete[] _map;
+    delete[] _segments;
+    delete[] _buffer;
+    _map = 0;
+    _segments = 0;
+    _buffer = 0;
+    _pages = 0;
+    _mutex.unlock();
+
+    return _bd->deinit();
+}
+
+int FlashTranslationBlockDevice::sync()
+{
+    return _bd->sync();
+}
+
+bd_addr_t FlashTranslationBlockDevice::tag_addr(uint32_t segment, uint32_t slot) const
+{
+    return segment * _segment_size + (1 + slot) * _tag_size;
+}
+
+bd_addr_t FlashTranslationBlockDevice::page_addr(uint32_t slot) const
+{
+    return (slot / _slots) * _segment_size + (1 + _slots) * _tag_size + (slot % _slots) * _page_size;
+}
+
+int FlashTranslationBlockDevice::check_tag(uint32_t segment, uint32_t slot, uint32_t &page, uint32_t &seq)
+{
+    uint8_t *buffer = _buffer + _page_size;
+    int err = _bd->read(buffer, tag_addr(segment, slot), _tag_size);
+    if (err) {
+        return err;
+    }
+
+    ftl_tag tag;
+    memcpy(&tag, buffer, sizeof(tag));
+    if (tag.crc != ftl_crc(&tag, offsetof(ftl_tag, crc))) {
+        return 0;
+    }
+
+    page = tag.page;
+    seq = tag.seq;
+    return 1;
+}
+
+int FlashTranslationBlockDevice::check_blank(uint32_t segment, uint32_t slot, uint8_t erased)
+{
+    uint8_t *tag_buffer = _buffer + _page_size;
+    int err = _bd->read(tag_buffer, tag_addr(segment, slot), _tag_size);
+    if (!err) {
+        err = _bd->read(_buffer, page_addr(segment * _slots + slot), _page_size);
+    }
+    if (err) {
+        return err;
+    }
+
+    for (bd_size_t i = 0; i < _page_size + _tag_size; i++) {
+        if (_buffer[i] != erased) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int FlashTranslationBlockDevice::scan()
+{
+    uint32_t *seqs = new uint32_t[_pages];
+    for (uint32_t i = 0; i < _pages; i++) {
+        _map[i] = NO_SLOT;
+    }
+
+    _active = NO_SEGMENT;
+    _free_count = 0;
+    _compacting = false;
+    uint32_t last_slot = NO_SLOT;
+    uint32_t last_erased = NO_VALUE;
+
+    for (uint32_t s = 0; s < _segment_count; s++) {
+        segment *seg = &_segments[s];
+        seg->erase_count = 0;
+        seg->live = 0;
+        seg->next = _slots;
+        seg->used = false;
+
+        int err = _bd->read(_buffer, s * _segment_size, _tag_size);
+        if (err) {
+            delete[] seqs;
+            return err;
+        }
+
+        // Segments without a valid header were never used or were being erased
+        ftl_header header;
+        memcpy(&header, _buffer, sizeof(header));
+        if ((header.magic != FTL_MAGIC) || (header.page_size != _page_size) ||
+                (header.crc != ftl_crc(&header, offsetof(ftl_header, crc)))) {
+            continue;
+        }
+        seg->erase_count = header.erase_count;
+        seg->used = true;
+
+        for (uint32_t i = 0; i < _slots; i++) {
+            uint32_t page, seq;
+            int res = check_tag(s, i, page, seq);
+            if (res < 0) {
+                delete[] seqs;
+                return res;
+            }
+            if (!res || ((page & ~UNMAPPED) >= _pages)) {
+                continue;
+            }
+
+            if ((last_slot == NO_SLOT) || ((int32_t)(seq - _seq) >= 0)) {
+                _seq = seq + 1;
+                last_slot = s * _slots + i;
+                last_erased = header.erased;
+            }
+
+            // The most recent copy of a page wins. An unmapping tag stays in
+            // the map, so compaction carries it along while it hides older copies
+            uint32_t entry = (s * _slots + i) | (page & UNMAPPED);
+            page &= ~UNMAPPED;
+            if (_map[page] != NO_SLOT) {
+                if ((int32_t)(seq - seqs[page]) < 0) {
+                    continue;
+                }
+                _segments[(_map[page] & ~UNMAPPED) / _slots].live--;
+            }
+            _map[page] = entry;
+            seqs[page] = seq;
+            seg->live++;
+        }
+    }
+    delete[] seqs;
+
+    // Continue the log after the last page written. A program interrupted by a
+    // power loss may have left the slot after it partially programmed, only the
+    // blank slots at the end of the segment are used. Slots are filled in order,
+    // so if the erased value is unknown only that one slot is skipped.
+    if (last_slot != NO_SLOT) {
+        _active = last_slot / _slots;
+        uint32_t next = last_slot % _slots + 2;
+        if ((last_erased != NO_VALUE) || (next > _slots)) {
+            next = _slots;
+        }
+        while ((last_erased != NO_VALUE) && (next > last_slot % _slots + 1)) {
+            int res = check_blank(_active, next - 1, last_erased);
+            if (res < 0) {
+                return res;
+            }
+            if (!res) {
+                break;
+            }
+            next--;
+        }
+        _segments[_active].next = next;
+    } else {
+        _seq = 0;
+    }
+
+    for (uint32_t s = 0; s < _segment_count; s++) {
+        if (_segments[s].used && !_segments[s].live && (s != _active)) {
+            _segments[s].used = false;
+        }
+        if (!_segments[s].used) {
+            _free_count++;
+        }
+    }
+
+    // Power was lost while compacting into the reserve. Free a segment whose
+    // pages fit in the rest of the active one, which needs no other segment. If
+    // none does, the pages can still be read but programs fail once the active
+    // segment is full.
+    if (!_free_count && (_active != NO_SEGMENT)) {
+        uint32_t victim = pick_victim(_slots - _segments[_active].next);
+        if (victim != NO_SEGMENT) {
+            return compact_segment(victim);
+        }
+    }
+
+    return BD_ERROR_OK;
+}
+
+uint32_t FlashTranslationBlockDevice::pick_victim(uint32_t max_live) const
+{
+    // The segment with the fewest live pages, the least erased one of those
+    uint32_t victim = NO_SEGMENT;
+    for (uint32_t s = 0; s < _segment_count; s++) {
+        const segment *seg = &_segments[s];
+        if (!seg->used || ((s == _active) && (seg->next < _slots))) {
+            continue;
+        }
+        if ((victim == NO_SEGMENT) || (seg->live < _segments[victim].live) ||
+                ((seg->live == _segments[victim].live) &&
+                 (seg->erase_count < _segments[victim].erase_count))) {
+            victim = s;
+        }
+    }
+    if ((victim != NO_SEGMENT) && (_segments[victim].live > max_live)) {
+        return NO_SEGMENT;
+    }
+    return victim;
+}
+
+int FlashTranslationBlockDevice::activate()
+{
+    // Take the free segment with the fewest erases
+    uint32_t best = NO_SEGMENT;
+    for (uint32_t s = 0; s < _segment_count; s++) {
+        if (!_segments[s].used &&
+                ((best == NO_SEGMENT) || (_segments[s].erase_count < _segments[best].erase_count))) {
+            best = s;
+        }
+    }
+    if (best == NO_SEGMENT) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    segment *seg = &_segments[best];
+    int err = _bd->erase(best * _segment_size, _segment_size);
+    if (err) {
+        return err;
+    }
+    seg->erase_count++;
+
+    // Record what erased storage reads as, so blank slots can be told apart
+    // from partially programmed ones after a power loss
+    uint8_t *buffer = _buffer + _page_size;
+    err = _bd->read(buffer, best * _segment_size, _tag_size);
+    if (err) {
+        return err;
+    }
+
+    ftl_header header;
+    header.magic = FTL_MAGIC;
+    header.erase_count = seg->erase_count;
+    header.page_size = _page_size;
+    header.erased = buffer[0];
+    for (bd_size_t i = 1; i < _tag_size; i++) {
+        if (buffer[i] != buffer[0]) {
+            header.erased = NO_VALUE;
+        }
+    }
+    header.crc = ftl_crc(&header, offsetof(ftl_header, crc));
+
+    memset(buffer, 0, _tag_size);
+    memcpy(buffer, &header, sizeof(header));
+    err = _bd->program(buffer, best * _segment_size, _tag_size);
+    if (err) {
+        return err;
+    }
+
+    seg->used = true;
+    seg->live = 0;
+    seg->next = 0;
+    _free_count--;
+    _active = best;
+    return BD_ERROR_OK;
+}
+
+int FlashTranslationBlockDevice::alloc_slot(uint32_t &slot)
+{
+    while ((_active == NO_SEGMENT) || (_segments[_active].next == _slots)) {
+        // Compaction moves pages into the segment kept in reserve
+        if ((_free_count > 1) || _compacting) {
+            int err = activate();
+            if (err) {
+                return err;
+            }
+            break;
+        }
+
+        uint32_t victim = pick_victim(_slots - 1);
+        if (victim == NO_SEGMENT) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        int err = compact_segment(victim);
+        if (err) {
+            return err;
+        }
+    }
+
+    slot = _active * _slots + _segments[_active].next;
+    _segments[_active].next++;
+    return BD_ERROR_OK;
+}
+
+void FlashTranslationBlockDevice::unmap(uint32_t page)
+{
+    if (_map[page] != NO_SLOT) {
+        _segments[(_map[page] & ~UNMAPPED) / _slots].live--;
+        _map[page] = NO_SLOT;
+    }
+}
+
+int FlashTranslationBlockDevice::write_page(const void *buffer, uint32_t page)
+{
+    uint32_t slot;
+    int err = alloc_slot(slot);
+    if (err) {
+        return err;
+    }
+
+    // Without a buffer only the tag is programmed, unmapping the page
+    if (buffer) {
+        err = _bd->program(buffer, page_addr(slot), _page_size);
+        if (err) {
+            return err;
+        }
+    }
+
+    // The tag is programmed last, a valid tag means the page is complete
+    ftl_tag tag;
+    tag.page = page | (buffer ? 0 : UNMAPPED);
+    tag.seq = _seq;
+    tag.crc = ftl_crc(&tag, offsetof(ftl_tag, crc));
+
+    uint8_t *tag_buffer = _buffer + _page_size;
+    memset(tag_buffer, 0, _tag_size);
+    memcpy(tag_buffer, &tag, sizeof(tag));
+    err = _bd->program(tag_buffer, tag_addr(slot / _slots, slot % _slots), _tag_size);
+    if (err) {
+        return err;
+    }
+    _seq++;
+
+    unmap(page);
+    _map[page] = slot | (buffer ? 0 : UNMAPPED);
+    _segments[slot / _slots].live++;
+    return BD_ERROR_OK;
+}
+
+int FlashTranslationBlockDevice::compact_segment(uint32_t victim)
+{
+    if (victim == NO_SEGMENT) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _compacting = true;
+    for (uint32_t i = 0; (i < _slots) && _segments[victim].live; i++) {
+        uint32_t page, seq;
+        int res = check_tag(victim, i, page, seq);
+        if (res < 0) {
+            _compacting = false;
+            return res;
+        }
+
+        // Only the pages and unmapping tags still mapped to the segment are moved
+        uint32_t entry = (victim * _slots + i) | (page & UNMAPPED);
+        page &= ~UNMAPPED;
+        if (!res || (page >= _pages) || (_map[page] != entry)) {
+            continue;
+        }
+
+        int err = BD_ERROR_OK;
+        if (entry & UNMAPPED) {
+            err = write_page(NULL, page);
+        } else {
+            err = _bd->read(_buffer, page_addr(entry), _page_size);
+            if (!err) {
+                err = write_page(_buffer, page);
+            }
+        }
+        if (err) {
+            _compacting = false;
+            return err;
+        }
+    }
+    _compacting = false;
+
+    // The segment is erased when it is taken again
+    _segments[victim].used = false;
+    _free_count++;
+    if (victim == _active) {
+        _active = NO_SEGMENT;
+    }
+    return BD_ERROR_OK;
+}
+
+int FlashTranslationBlockDevice::compact()
+{
+    _mutex.lock();
+    int err = compact_idle();
+    _mutex.unlock();
+    return err;
+}
+
+int FlashTranslationBlockDevice::compact_idle()
+{
+    if (_free_count < 1) {
+        return BD_ERROR_OK;
+    }
+
+    // Move the data out of a segment falling behind in erases, so it gets reused
+    uint32_t coldest = NO_SEGMENT;
+    uint32_t max_erases = 0;
+    for (uint32_t s = 0; s < _segment_count; s++) {
+        if (_segments[s].erase_count > max_erases) {
+            max_erases = _segments[s].erase_count;
+        }
+        if (_segments[s].used && (s != _active) &&
+                ((coldest == NO_SEGMENT) || (_segments[s].erase_count < _segments[coldest].erase_count))) {
+            coldest = s;
+        }
+    }
+    if ((coldest != NO_SEGMENT) && (_segments[coldest].erase_count + _wear_threshold < max_erases)) {
+        return compact_segment(coldest);
+    }
+
+    uint32_t victim = pick_victim(_slots - 1);
+    if (victim == NO_SEGMENT) {
+        return BD_ERROR_OK;
+    }
+    return compact_segment(victim);
+}
+
+int FlashTranslationBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_read(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _mutex.lock();
+    int err = BD_ERROR_OK;
+    uint8_t *buffer = static_cast<uint8_t *>(b);
+    for (uint32_t page = addr / _page_size; !err && (size > 0); page++) {
+        if (_map[page] & UNMAPPED) {
+            // Never programmed or erased
+            memset(buffer, 0xff, _page_size);
+        } else {
+            err = _bd->read(buffer, page_addr(_map[page]), _page_size);
+        }
+
+        buffer += _page_size;
+        size -= _page_size;
+    }
+    _mutex.unlock();
+
+    return err;
+}
+
+int FlashTranslationBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_program(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _mutex.lock();
+    int err = BD_ERROR_OK;
+    const uint8_t *buffer = static_cast<const uint8_t *>(b);
+    for (uint32_t page = addr / _page_size; !err && (size > 0); page++) {
+        err = write_page(buffer, page);
+
+        buffer += _page_size;
+        size -= _page_size;
+    }
+    _mutex.unlock();
+
+    return err;
+}
+
+int FlashTranslationBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_erase(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _mutex.lock();
+    int err = BD_ERROR_OK;
+    for (uint32_t page = addr / _page_size; !err && (page < (addr + size) / _page_size); page++) {
+        // Record the unmapping, so older copies of the page don't come back on init
+        if (!(_map[page] & UNMAPPED)) {
+            err = write_page(NULL, page);
+        }
+    }
+    _mutex.unlock();
+
+    return err;
+}
+
+int FlashTranslationBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    return erase(addr, size);
+}
+
+bd_size_t FlashTranslationBlockDevice::get_read_size() const
+{
+    return _page_size;
+}
+
+bd_size_t FlashTranslationBlockDevice::get_program_size() const
+{
+    return _page_size;
+}
+
+bd_size_t FlashTranslationBlockDevice::get_erase_size() const
+{
+    return _page_size;
+}
+
+bd_size_t FlashTranslationBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _page_size;
+}
+
+int FlashTranslationBlockDevice::get_erase_value() const
+{
+    return -1;
+}
+
+bd_size_t FlashTranslationBlockDevice::size() const
+{
+    return (bd_size_t)_pages * _page_size;
+}
@@ -0,0 +1,233 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_FLASH_TRANSLATION_BLOCK_DEVICE_H
+#define MBED_FLASH_TRANSLATION_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+#include "PlatformMutex.h"
+
+/** Block device spreading programs of another block device over all of its erase blocks
+ *
+ *  A log structured flash translation layer. Logical pages are never programmed in
+ *  place: every program appends the page to the active erase block (a segment) and
+ *  remaps it, so file systems which rewrite the same sectors, like FAT, don't erase
+ *  the same flash sectors over and over. Each segment starts with a header holding
+ *  its erase count, followed by a tag per page recording the logical page and a
+ *  sequence number, followed by the pages. The mapping is rebuilt from the tags on
+ *  init, the most recent copy of a page wins.
+ *
+ *  Segments whose pages have all been rewritten are reused, the free segment with
+ *  the fewest erases first. When the free segments run out, the live pages of the
+ *  segment with the fewest of them are moved to the end of the log (compaction).
+ *  compact can also be called when the device is idle, to do that work ahead of
+ *  time and to move cold data out of segments which fall behind in erases.
+ *
+ *  Erasing only unmaps pages, so the contents of erased pages are undefined. The
+ *  unmapping is recorded with a tag of its own, which hides the older copies of the
+ *  page from init and takes a slot until the page is programmed again. Erasing
+ *  pages which are not mapped costs nothing. Two segments are kept in reserve, the
+ *  size of the device is the space of the other segments.
+ *
+ *  A segment whose header was not completely programmed before a power loss is
+ *  treated as free and erased again when it is taken. When a power loss during a
+ *  compaction left no free segment, init moves the pages of a segment into what
+ *  is left of the active one.
+ *
+ *  @note The underlying device must have a uniform erase size and at least 3 erase
+ *        blocks. The mapping takes 4 bytes of RAM per logical page.
+ *
+ *  @code
+ *  #include "mbed.h"
+ *  #include "FlashIAPBlockDevice.h"
+ *  #include "FlashTranslationBlockDevice.h"
+ *  #include "FATFileSystem.h"
+ *
+ *  FlashIAPBlockDevice flash(0x80000, 0x40000);
+ *  FlashTranslationBlockDevice ftl(&flash, 512);
+ *  FATFileSystem fs("fs", &ftl);
+ *  @endcode
+ */
+class FlashTranslationBlockDevice : public BlockDevice
+{
+public:
+    /** Lifetime of the flash translation block device
+     *
+     *  @param bd               Block device to back the FlashTranslationBlockDevice
+     *  @param page_size        Size of a logical page in bytes, which is the read,
+     *                          program and erase size of the device. Must be a multiple
+     *                          of the program size of the underlying device.
+     *  @param wear_threshold   Difference in erase counts above which compact moves
+     *                          the data of the least erased segment
+     */
+    FlashTranslationBlockDevice(BlockDevice *bd, bd_size_t page_size = 512,
+                                uint32_t wear_threshold = 16);
+
+    /** Lifetime of a block device
+     */
+    virtual ~FlashTranslationBlockDevice();
+
+    /** Initialize a block device
+     *
+     *  Scans the underlying device to rebuild the mapping of logical pages
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  The pages are written to the end of the log, they don't need to be erased
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  Unmaps the pages, the underlying device is not erased. Programs a tag
+     *  for each page which is mapped, so erasing may have to compact.
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Mark blocks as no longer in use
+     *
+     *  @param addr     Address of block to mark as unused
+     *  @param size     Size to mark as unused in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int trim(bd_addr_t addr, bd_size_t size);
+
+    /** Reclaim space ahead of time
+     *
+     *  Moves the live pages of one segment to the end of the log, so following
+     *  programs don't have to. Picks the least erased segment when its erase count
+     *  is more than the wear threshold behind, or else the segment with the most
+     *  rewritten pages. Meant to be called when the device is idle, from any thread.
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int compact();
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  @return         -1, erased pages have undefined contents
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the device
+     *
+     *  @return         Size of the device in bytes
+     */
+    virtual bd_size_t size() const;
+
+private:
+    struct segment {
+        uint32_t erase_count;
+        uint32_t live;
+        uint32_t next;
+        bool used;
+    };
+
+    int init_ftl();
+    int compact_idle();
+    int check_tag(uint32_t segment, uint32_t slot, uint32_t &page, uint32_t &seq);
+    int check_blank(uint32_t segment, uint32_t slot, uint8_t erased);
+    int scan();
+    uint32_t pick_victim(uint32_t max_live) const;
+    int activate();
+    int alloc_slot(uint32_t &slot);
+    int write_page(const void *buffer, uint32_t page);
+    void unmap(uint32_t page);
+    int compact_segment(uint32_t victim);
+    bd_addr_t tag_addr(uint32_t segment, uint32_t slot) const;
+    bd_addr_t page_addr(uint32_t slot) const;
+
+    BlockDevice *_bd;
+    bd_size_t _page_size;
+    uint32_t _wear_threshold;
+    bd_size_t _segment_size;
+    bd_size_t _tag_size;
+    uint32_t _segment_count;
+    uint32_t _slots;
+    uint32_t _pages;
+    uint32_t *_map;
+    segment *_segments;
+    uint8_t *_buffer;
+    uint32_t _active;
+    uint32_t _free_count;
+    uint32_t _seq;
+    bool _compacting;
+    PlatformMutex _mutex;
+};
+
+
+#endif
@@ -15,11 +15,14 @@
  */
 
 #include "HeapBlockDevice.h"
+#include <algorithm>
+#include <limits.h>
 
 
 HeapBlockDevice::HeapBlockDevice(bd_size_t size, bd_size_t block)
     : _read_size(block), _program_size(block), _erase_size(block)
     , _count(size / block), _blocks(0)
+    , _read_latency(0), _program_latency(0), _erase_latency(0), _queue(0)
 {
     MBED_ASSERT(_count * _erase_size == size);
 }
@@ -27,6 +30,7 @@ HeapBlockDevice::HeapBlockDevice(bd_size_t size, bd_size_t block)
 HeapBlockDevice::HeapBlockDevice(bd_size_t size, bd_size_t read, bd_size_t program, bd_size_t erase)
     : _read_size(read), _program_size(program), _erase_size(erase)
     , _count(size / erase), _blocks(0)
+    , _read_latency(0), _program_latency(0), _erase_latency(0), _queue(0)
 {
     MBED_ASSERT(_count * _erase_size == size);
 }
@@ -99,6 +103,10 @@ int HeapBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
     MBED_ASSERT(is_valid_read(addr, size));
     uint8_t *buffer = static_cast<uint8_t*>(b);
 
+    if (_read_latency) {
+        wait_us(_read_latency);
+    }
+
     while (size > 0) {
         bd_addr_t hi = addr / _erase_size;
         bd_addr_t lo = addr % _erase_size;
@@ -123,6 +131,10 @@ int HeapBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
     MBED_ASSERT(is_valid_program(addr, size));
     const uint8_t *buffer = static_cast<const uint8_t*>(b);
 
+    if (_program_latency) {
+        wait_us(_program_latency);
+    }
+
     while (size > 0) {
         bd_addr_t hi = addr / _erase_size;
         bd_addr_t lo = addr % _erase_size;
@@ -150,6 +162,76 @@ int HeapBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     MBED_ASSERT(is_valid_erase(addr, size));
     // TODO assert on programming unerased blocks
 
+    // Wait block by block, as the total may not fit in wait_us's argument
+    if (_erase_latency) {
+        for (bd_size_t i = 0; i < size / _erase_size; i++) {
+            wait_us(_erase_latency);
+        }
+    }
+
     return 0;
 }
 
+void HeapBlockDevice::set_latency(uint32_t read_us, uint32_t program_us, uint32_t erase_us)
+{
+    // wait_us takes an int
+    _read_latency = std::min(read_us, (uint32_t) INT_MAX);
+    _program_latency = std::min(program_us, (uint32_t) INT_MAX);
+    _erase_latency = std::min(erase_us, (uint32_t) INT_MAX);
+}
+
+void HeapBlockDevice::set_async_queue(events::EventQueue *queue)
+{
+    _queue = queue;
+}
+
+int HeapBlockDevice::read_async(void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    if (!_queue) {
+        return BlockDevice::read_async(buffer, addr, size, cb);
+    }
+
+    if (!_queue->call(this, &HeapBlockDevice::complete_read, buffer, addr, size, cb)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+int HeapBlockDevice::program_async(const void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    if (!_queue) {
+        return BlockDevice::program_async(buffer, addr, size, cb);
+    }
+
+    if (!_queue->call(this, &HeapBlockDevice::complete_program, buffer, addr, size, cb)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+int HeapBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    if (!_queue) {
+        return BlockDevice::erase_async(addr, size, cb);
+    }
+
+    if (!_queue->call(this, &HeapBlockDevice::complete_erase, addr, size, cb)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+void HeapBlockDevice::complete_read(void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    cb(read(buffer, addr, size));
+}
+
+void HeapBlockDevice::complete_program(const void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    cb(program(buffer, addr, size));
+}
+
+void HeapBlockDevice::complete_erase(bd_addr_t addr, bd_size_t size, bd_callback_t cb)
+{
+    cb(erase(addr, size));
+}
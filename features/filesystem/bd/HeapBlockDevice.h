@@ -70,6 +70,25 @@ public:
     HeapBlockDevice(bd_size_t size, bd_size_t read, bd_size_t program, bd_size_t erase);
     virtual ~HeapBlockDevice();
 
+    /** Simulate the access times of a real device
+     *
+     *  @param read_us      Time taken by a read in microseconds
+     *  @param program_us   Time taken by a program in microseconds
+     *  @param erase_us     Time taken by the erase of each erase block in microseconds
+     */
+    void set_latency(uint32_t read_us, uint32_t program_us, uint32_t erase_us);
+
+    /** Run asynchronous operations on an event queue
+     *
+     *  The queue is usually dispatched by a separate thread, the operations and
+     *  their completion callbacks then run in that thread while the submitting
+     *  thread continues.
+     *
+     *  @param queue    Event queue to run operations on, or NULL to complete
+     *                  them synchronously
+     */
+    void set_async_queue(events::EventQueue *queue);
+
     /** Initialize a block device
      *
      *  @return         0 on success or a negative error code on failure
@@ -112,6 +131,35 @@ public:
      */
     virtual int erase(bd_addr_t addr, bd_size_t size);
 
+    /** Submit an asynchronous read of blocks from the block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @param cb       Callback called with the result of the read
+     *  @return         0 if the read was submitted, negative error code on failure
+     */
+    virtual int read_async(void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb);
+
+    /** Submit an asynchronous program of blocks to the block device
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @param cb       Callback called with the result of the program
+     *  @return         0 if the program was submitted, negative error code on failure
+     */
+    virtual int program_async(const void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb);
+
+    /** Submit an asynchronous erase of blocks on the block device
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @param cb       Callback called with the result of the erase
+     *  @return         0 if the erase was submitted, negative error code on failure
+     */
+    virtual int erase_async(bd_addr_t addr, bd_size_t size, bd_callback_t cb);
+
     /** Get the size of a readable block
      *
      *  @return         Size of a readable block in bytes
@@ -145,11 +193,19 @@ public:
     virtual bd_size_t size() const;
 
 private:
+    void complete_read(void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb);
+    void complete_program(const void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb);
+    void complete_erase(bd_addr_t addr, bd_size_t size, bd_callback_t cb);
+
     bd_size_t _read_size;
     bd_size_t _program_size;
     bd_size_t _erase_size;
     bd_size_t _count;
     uint8_t **_blocks;
+    uint32_t _read_latency;
+    uint32_t _program_latency;
+    uint32_t _erase_latency;
+    events::EventQueue *_queue;
 };
 
 
@@ -15,19 +15,38 @@
  */
 
 #include "ProfilingBlockDevice.h"
+#include <string.h>
 
 
-ProfilingBlockDevice::ProfilingBlockDevice(BlockDevice *bd)
+ProfilingBlockDevice::ProfilingBlockDevice(BlockDevice *bd, bool block_erases)
     : _bd(bd)
     , _read_count(0)
     , _program_count(0)
     , _erase_count(0)
+    , _block_erases(block_erases)
+    , _block_erase_counts(0)
 {
 }
 
+ProfilingBlockDevice::~ProfilingBlockDevice()
+{
+    delete[] _block_erase_counts;
+}
+
 int ProfilingBlockDevice::init()
 {
-    return _bd->init();
+    int err = _bd->init();
+    if (err) {
+        return err;
+    }
+
+    if (_block_erases && !_block_erase_counts) {
+        bd_size_t blocks = _bd->size() / _bd->get_erase_size();
+        _block_erase_counts = new uint32_t[blocks];
+        memset(_block_erase_counts, 0, blocks * sizeof(uint32_t));
+    }
+
+    return 0;
 }
 
 int ProfilingBlockDevice::deinit()
@@ -63,6 +82,12 @@ int ProfilingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     int err = _bd->erase(addr, size);
     if (!err) {
         _erase_count += size;
+        if (_block_erase_counts) {
+            bd_size_t erase_size = _bd->get_erase_size();
+            for (bd_size_t i = 0; i < size; i += erase_size) {
+                _block_erase_counts[(addr + i) / erase_size] += 1;
+            }
+        }
     }
     return err;
 }
@@ -102,6 +127,9 @@ void ProfilingBlockDevice::reset()
     _read_count = 0;
     _program_count = 0;
     _erase_count = 0;
+    if (_block_erase_counts) {
+        memset(_block_erase_counts, 0, (_bd->size() / _bd->get_erase_size()) * sizeof(uint32_t));
+    }
 }
 
 bd_size_t ProfilingBlockDevice::get_read_count() const
@@ -118,3 +146,11 @@ bd_size_t ProfilingBlockDevice::get_erase_count() const
 {
     return _erase_count;
 }
+
+bd_size_t ProfilingBlockDevice::get_erase_count(bd_addr_t addr) const
+{
+    if (!_block_erase_counts) {
+        return 0;
+    }
+    return _block_erase_counts[addr / _bd->get_erase_size()];
+}
@@ -49,13 +49,16 @@ class ProfilingBlockDevice : public BlockDevice
 public:
     /** Lifetime of the memory block device
      *
-     *  @param bd       Block device to back the ProfilingBlockDevice
+     *  @param bd               Block device to back the ProfilingBlockDevice
+     *  @param block_erases     Also count the erases of each erase block, which
+     *                          takes 4 bytes of RAM per block. Requires a
+     *                          uniform erase size.
      */
-    ProfilingBlockDevice(BlockDevice *bd);
+    ProfilingBlockDevice(BlockDevice *bd, bool block_erases = false);
 
     /** Lifetime of a block device
      */
-    virtual ~ProfilingBlockDevice() {};
+    virtual ~ProfilingBlockDevice();
 
     /** Initialize a block device
      *
@@ -175,11 +178,22 @@ public:
      */
     bd_size_t get_erase_count() const;
 
+    /** Get number of times an erase block has been erased
+     *
+     *  Only counted when enabled on construction
+     *
+     *  @param addr     Address within the erasable block
+     *  @return The number of erases of the block containing addr
+     */
+    bd_size_t get_erase_count(bd_addr_t addr) const;
+
 private:
     BlockDevice *_bd;
     bd_size_t _read_count;
     bd_size_t _program_count;
     bd_size_t _erase_count;
+    bool _block_erases;
+    uint32_t *_block_erase_counts;
 };
 
 
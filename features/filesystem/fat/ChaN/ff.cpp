@@ -221,6 +221,12 @@
 #endif
 
 
+/* Sector window cache */
+#if FF_FS_WINDOWS < 1 || (FF_FS_WINDOWS > 1 && !FF_FS_HEAPBUF)
+#error Wrong FF_FS_WINDOWS setting
+#endif
+
+
 /* Definitions of sector size */
 #if (FF_MAX_SS < FF_MIN_SS) || (FF_MAX_SS != 512 && FF_MAX_SS != 1024 && FF_MAX_SS != 2048 && FF_MAX_SS != 4096) || (FF_MIN_SS != 512 && FF_MIN_SS != 1024 && FF_MIN_SS != 2048 && FF_MIN_SS != 4096)
 #error Wrong sector size configuration
@@ -1050,6 +1056,57 @@ FRESULT sync_window (	/* Returns FR_OK or FR_DISK_ERR */
 #endif
 
 
+#if FF_FS_WINDOWS > 1
+static
+int cache_window (	/* Returns 1 if the sector has been restored to the window from a copy */
+	FATFS* fs,			/* Filesystem object */
+	DWORD sector		/* Sector number to make appearance in the fs->win[] */
+)
+{
+	UINT i, n, lru = 0;
+	BYTE *buf, b;
+
+
+	for (i = 0; i < FF_FS_WINDOWS - 1; i++) {	/* Copies of the (clean) window are outdated */
+		if (fs->winsects[i] == fs->winsect) fs->winsects[i] = 0xFFFFFFFF;
+	}
+	for (i = 0; i < FF_FS_WINDOWS - 1 && fs->winsects[i] != sector; i++) {	/* Find the sector, or the copy to reuse */
+		if (fs->winsects[lru] != 0xFFFFFFFF && (fs->winsects[i] == 0xFFFFFFFF || fs->winuse[i] < fs->winuse[lru])) lru = i;
+	}
+	if (i < FF_FS_WINDOWS - 1) {	/* Swap the copy with the window (pointers into win[] stay valid) */
+		buf = fs->winbuf + i * SS(fs);
+		for (n = 0; n < SS(fs); n++) {
+			b = buf[n]; buf[n] = fs->win[n]; fs->win[n] = b;
+		}
+		fs->winsects[i] = fs->winsect; fs->winuse[i] = ++fs->winclock;
+		fs->winsect = sector;
+		return 1;
+	}
+	if (fs->winsect != 0xFFFFFFFF) {	/* Keep a copy of the window before it is reloaded */
+		mem_cpy(fs->winbuf + lru * SS(fs), fs->win, SS(fs));
+		fs->winsects[lru] = fs->winsect; fs->winuse[lru] = ++fs->winclock;
+	}
+	return 0;
+}
+
+
+static
+void invalidate_windows (
+	FATFS* fs,			/* Filesystem object */
+	DWORD sect,			/* First sector written bypassing the window */
+	DWORD count			/* Number of sectors */
+)
+{
+	UINT i;
+
+
+	for (i = 0; i < FF_FS_WINDOWS - 1; i++) {
+		if (fs->winsects[i] - sect < count) fs->winsects[i] = 0xFFFFFFFF;
+	}
+}
+#endif
+
+
 static
 FRESULT move_window (	/* Returns FR_OK or FR_DISK_ERR */
 	FATFS* fs,			/* Filesystem object */
@@ -1062,6 +1119,9 @@ FRESULT move_window (	/* Returns FR_OK or FR_DISK_ERR */
 	if (sector != fs->winsect) {	/* Window offset changed? */
 #if !FF_FS_READONLY
 		res = sync_window(fs);		/* Write-back changes */
+#endif
+#if FF_FS_WINDOWS > 1
+		if (res == FR_OK && cache_window(fs, sector)) return FR_OK;	/* Restored from a copy */
 #endif
 		if (res == FR_OK) {			/* Fill sector window with new data */
 			if (disk_read(fs->pdrv, fs->win, sector, 1) != RES_OK) {
@@ -1669,6 +1729,9 @@ FRESULT dir_clear (	/* Returns FR_OK or FR_DISK_ERR */
 		ibuf = fs->win; szb = 1;	/* Use window buffer (single-sector writes may take a time) */
 		for (n = 0; n < fs->csize && disk_write(fs->pdrv, ibuf, sect + n, szb) == RES_OK; n += szb) ;	/* Fill the cluster with 0 */
 	}
+#if FF_FS_WINDOWS > 1
+	invalidate_windows(fs, sect, fs->csize);
+#endif
 	return (n == fs->csize) ? FR_OK : FR_DISK_ERR;
 }
 #endif	/* !FF_FS_READONLY */
@@ -3198,6 +3261,9 @@ BYTE check_fs (	/* 0:FAT, 1:exFAT, 2:Valid BS but not FAT, 3:Not a BS, 4:Disk er
 )
 {
 	fs->wflag = 0; fs->winsect = 0xFFFFFFFF;		/* Invaidate window */
+#if FF_FS_WINDOWS > 1
+	invalidate_windows(fs, 0, 0xFFFFFFFF);
+#endif
 	if (move_window(fs, sect) != FR_OK) return 4;	/* Load boot record */
 
 	if (ld_word(fs->win + BS_55AA) != 0xAA55) return 3;	/* Check boot record signature (always placed here even if the sector size is >512) */
@@ -3282,6 +3348,17 @@ FRESULT find_volume (	/* FR_OK(0): successful, !=0: any error occurred */
 		if (!fs->win)
 			return FR_NOT_ENOUGH_CORE;
 	}
+#if FF_FS_WINDOWS > 1
+	if (!fs->winbuf) {
+		fs->winbuf = (BYTE*)ff_memalloc(SS(fs) * (FF_FS_WINDOWS - 1));	/* Allocate buffers to back the window copies */
+		if (!fs->winbuf)
+			return FR_NOT_ENOUGH_CORE;
+		fs->winclock = 0;
+		for (i = 0; i < FF_FS_WINDOWS - 1; i++) {
+			fs->winsects[i] = 0xFFFFFFFF; fs->winuse[i] = 0;
+		}
+	}
+#endif
 #endif
 
 	/* Find an FAT partition on the drive. Supports only generic partitioning rules, FDISK and SFD. */
@@ -3525,6 +3602,9 @@ FRESULT f_mount (
 		cfs->fs_type = 0;				/* Clear old fs object */
 #if FF_FS_HEAPBUF
 		ff_memfree(cfs->win);			/* Clean up window buffer */
+#if FF_FS_WINDOWS > 1
+		ff_memfree(cfs->winbuf);
+#endif
 #endif
 	}
 
@@ -3535,6 +3615,9 @@ FRESULT f_mount (
 #endif
 #if FF_FS_HEAPBUF
 		fs->win = 0;					/* NULL buffer to prevent use of uninitialized buffer */
+#if FF_FS_WINDOWS > 1
+		fs->winbuf = 0;
+#endif
 #endif
 	}
 	FatFs[vol] = fs;					/* Register new fs object */
@@ -3920,6 +4003,9 @@ FRESULT f_write (
 					cc = fs->csize - csect;
 				}
 				if (disk_write(fs->pdrv, wbuff, sect, cc) != RES_OK) ABORT(fs, FR_DISK_ERR);
+#if FF_FS_WINDOWS > 1
+				invalidate_windows(fs, sect, cc);
+#endif
 #if FF_FS_MINIMIZE <= 2
 #if FF_FS_TINY
 				if (fs->winsect - sect < cc) {	/* Refill sector cache if it gets invalidated by the direct write */
@@ -129,6 +129,12 @@ typedef struct {
 #else
 	BYTE	win[FF_MAX_SS];	/* Disk access window for Directory, FAT (and file data at tiny cfg) */
 #endif
+#if FF_FS_WINDOWS > 1
+	BYTE	*winbuf;		/* Clean copies of recently used windows */
+	DWORD	winsects[FF_FS_WINDOWS - 1];	/* Sector held by each copy */
+	DWORD	winuse[FF_FS_WINDOWS - 1];	/* Last use of each copy */
+	DWORD	winclock;		/* Window use counter */
+#endif
 } FATFS;
 
 
@@ -44,7 +44,7 @@
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
-#define FF_USE_FASTSEEK	0
+#define FF_USE_FASTSEEK	1
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
@@ -240,6 +240,18 @@
 /  on underlying sector size. */
 
 
+#ifdef MBED_CONF_FAT_CHAN_FF_FS_WINDOWS
+#define FF_FS_WINDOWS   MBED_CONF_FAT_CHAN_FF_FS_WINDOWS
+#else
+#define FF_FS_WINDOWS   1
+#endif
+/* This option sets the number of sector windows of a volume (1 or more).
+/  With more than one window, sectors of the FAT, directories (and file data at
+/  tiny cfg) stay cached when the window moves, and the least recently used
+/  window is reloaded. Each window takes a sector sized buffer. Requires
+/  FF_FS_HEAPBUF. */
+
+
 #define FF_FS_NORTC		0
 #define FF_NORTC_MON	1
 #define FF_NORTC_MDAY	1
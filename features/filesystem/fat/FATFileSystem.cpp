@@ -180,6 +180,36 @@ static DWORD disk_get_sector_count(BYTE pdrv)
     return scount;
 }
 
+// Check if a sector still holds the erase value, so writing it needs no erase
+static bool disk_is_erased(BYTE pdrv, bd_addr_t addr, bd_size_t size)
+{
+    uint8_t buffer[64];
+    int erase_value = _ffs[pdrv]->get_erase_value();
+    bd_size_t read_size = _ffs[pdrv]->get_read_size();
+    if (erase_value < 0 || read_size > sizeof(buffer)) {
+        return false;
+    }
+
+    bd_size_t chunk = sizeof(buffer) - sizeof(buffer) % read_size;
+    while (size > 0) {
+        bd_size_t len = size < chunk ? size : chunk;
+        if (_ffs[pdrv]->read(buffer, addr, len)) {
+            return false;
+        }
+
+        for (bd_size_t i = 0; i < len; i++) {
+            if (buffer[i] != erase_value) {
+                return false;
+            }
+        }
+
+        addr += len;
+        size -= len;
+    }
+
+    return true;
+}
+
 DSTATUS disk_status(BYTE pdrv)
 {
     debug_if(FFS_DBG, "disk_status on pdrv [%d]\n", pdrv);
@@ -208,12 +238,27 @@ DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
     DWORD ssize = disk_get_sector_size(pdrv);
     bd_addr_t addr = (bd_addr_t)sector*ssize;
     bd_size_t size = (bd_size_t)count*ssize;
-    int err = _ffs[pdrv]->erase(addr, size);
-    if (err) {
-        return RES_PARERR;
+
+    // Only erase the sectors which aren't blank yet, each run of them at once
+    bd_addr_t erase_addr = addr;
+    bd_size_t erase_size = 0;
+    for (UINT i = 0; i <= count; i++) {
+        bd_addr_t sector_addr = addr + (bd_addr_t)i*ssize;
+        if (i < count && !disk_is_erased(pdrv, sector_addr, ssize)) {
+            if (!erase_size) {
+                erase_addr = sector_addr;
+            }
+            erase_size += ssize;
+        } else if (erase_size) {
+            int err = _ffs[pdrv]->erase(erase_addr, erase_size);
+            if (err) {
+                return RES_PARERR;
+            }
+            erase_size = 0;
+        }
     }
 
-    err = _ffs[pdrv]->program(buff, addr, size);
+    int err = _ffs[pdrv]->program(buff, addr, size);
     if (err) {
         return RES_PARERR;
     }
@@ -269,7 +314,7 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
 
 // Filesystem implementation (See FATFilySystem.h)
 FATFileSystem::FATFileSystem(const char *name, BlockDevice *bd)
-        : FileSystem(name), _id(-1) {
+        : FileSystem(name), _id(-1), _fast_seek(false) {
     if (bd) {
         mount(bd);
     }
@@ -497,11 +542,58 @@ void FATFileSystem::unlock()
 
 
 ////// File operations //////
+
+// File handle, the FIL comes first so a handle is also a FatFs file object
+struct fat_file {
+    FIL fil;
+    bool fast_seek;     // Use a cluster link map table when seeking
+    FSIZE_t map_size;   // Bytes of the file covered by the table
+};
+
+// Build the cluster link map table of a file, growing it until all fragments fit
+static FRESULT fat_build_link_map(fat_file *fh)
+{
+    DWORD size = 32;
+    while (true) {
+        DWORD *table = new DWORD[size];
+        table[0] = size;
+        fh->fil.cltbl = table;
+
+        FRESULT res = f_lseek(&fh->fil, CREATE_LINKMAP);
+        if (res == FR_OK) {
+            // The table covers whole clusters, including the unused end of the last one
+            FATFS *fs = fh->fil.obj.fs;
+            FSIZE_t cluster = (FSIZE_t)fs->csize * fs->ssize;
+            fh->map_size = 0;
+            for (DWORD *fragment = &table[1]; *fragment; fragment += 2) {
+                fh->map_size += *fragment * cluster;
+            }
+            return FR_OK;
+        }
+
+        // The required size is reported in the first item
+        size = table[0];
+        fh->fil.cltbl = NULL;
+        delete[] table;
+        if (res != FR_NOT_ENOUGH_CORE) {
+            return res;
+        }
+    }
+}
+
+static void fat_drop_link_map(fat_file *fh)
+{
+    delete[] fh->fil.cltbl;
+    fh->fil.cltbl = NULL;
+}
+
 int FATFileSystem::file_open(fs_file_t *file, const char *path, int flags)
 {
     debug_if(FFS_DBG, "open(%s) on filesystem [%s], drv [%s]\n", path, getName(), _id);
 
-    FIL *fh = new FIL;
+    fat_file *fh = new fat_file;
+    fh->fast_seek = _fast_seek;
+    fh->map_size = 0;
     Deferred<const char*> fpath = fat_path_prefix(_id, path);
 
     /* POSIX flags -> FatFS open mode */
@@ -527,7 +619,7 @@ int FATFileSystem::file_open(fs_file_t *file, const char *path, int flags)
     }
 
     lock();
-    FRESULT res = f_open(fh, fpath, openmode);
+    FRESULT res = f_open(&fh->fil, fpath, openmode);
 
     if (res != FR_OK) {
         unlock();
@@ -544,19 +636,20 @@ int FATFileSystem::file_open(fs_file_t *file, const char *path, int flags)
 
 int FATFileSystem::file_close(fs_file_t file)
 {
-    FIL *fh = static_cast<FIL*>(file);
+    fat_file *fh = static_cast<fat_file*>(file);
 
     lock();
-    FRESULT res = f_close(fh);
+    FRESULT res = f_close(&fh->fil);
     unlock();
 
+    delete[] fh->fil.cltbl;
     delete fh;
     return fat_error_remap(res);
 }
 
 ssize_t FATFileSystem::file_read(fs_file_t file, void *buffer, size_t len)
 {
-    FIL *fh = static_cast<FIL*>(file);
+    FIL *fh = &static_cast<fat_file*>(file)->fil;
 
     lock();
     UINT n;
@@ -573,11 +666,16 @@ ssize_t FATFileSystem::file_read(fs_file_t file, void *buffer, size_t len)
 
 ssize_t FATFileSystem::file_write(fs_file_t file, const void *buffer, size_t len)
 {
-    FIL *fh = static_cast<FIL*>(file);
+    fat_file *fh = static_cast<fat_file*>(file);
 
     lock();
+    // Clusters allocated by the write aren't in the link map, follow the FAT instead
+    if (fh->fil.cltbl && f_tell(&fh->fil) + len > fh->map_size) {
+        fat_drop_link_map(fh);
+    }
+
     UINT n;
-    FRESULT res = f_write(fh, buffer, len, &n);
+    FRESULT res = f_write(&fh->fil, buffer, len, &n);
     unlock();
 
     if (res != FR_OK) {
@@ -590,7 +688,7 @@ ssize_t FATFileSystem::file_write(fs_file_t file, const void *buffer, size_t len
 
 int FATFileSystem::file_sync(fs_file_t file)
 {
-    FIL *fh = static_cast<FIL*>(file);
+    FIL *fh = &static_cast<fat_file*>(file)->fil;
 
     lock();
     FRESULT res = f_sync(fh);
@@ -604,17 +702,27 @@ int FATFileSystem::file_sync(fs_file_t file)
 
 off_t FATFileSystem::file_seek(fs_file_t file, off_t offset, int whence)
 {
-    FIL *fh = static_cast<FIL*>(file);
+    fat_file *fh = static_cast<fat_file*>(file);
 
     lock();
     if (whence == SEEK_END) {
-        offset += f_size(fh);
+        offset += f_size(&fh->fil);
     } else if(whence==SEEK_CUR) {
-        offset += f_tell(fh);
+        offset += f_tell(&fh->fil);
+    }
+
+    FRESULT res = FR_OK;
+    if ((FSIZE_t)offset > f_size(&fh->fil)) {
+        // Fast seeking doesn't expand files
+        fat_drop_link_map(fh);
+    } else if (fh->fast_seek && !fh->fil.cltbl) {
+        res = fat_build_link_map(fh);
     }
 
-    FRESULT res = f_lseek(fh, offset);
-    off_t noffset = fh->fptr;
+    if (res == FR_OK) {
+        res = f_lseek(&fh->fil, offset);
+    }
+    off_t noffset = fh->fil.fptr;
     unlock();
 
     if (res != FR_OK) {
@@ -627,7 +735,7 @@ off_t FATFileSystem::file_seek(fs_file_t file, off_t offset, int whence)
 
 off_t FATFileSystem::file_tell(fs_file_t file)
 {
-    FIL *fh = static_cast<FIL*>(file);
+    FIL *fh = &static_cast<fat_file*>(file)->fil;
 
     lock();
     off_t res = f_tell(fh);
@@ -638,7 +746,7 @@ off_t FATFileSystem::file_tell(fs_file_t file)
 
 off_t FATFileSystem::file_size(fs_file_t file)
 {
-    FIL *fh = static_cast<FIL*>(file);
+    FIL *fh = &static_cast<fat_file*>(file)->fil;
 
     lock();
     off_t res = f_size(fh);
@@ -648,6 +756,14 @@ off_t FATFileSystem::file_size(fs_file_t file)
 }
 
 
+void FATFileSystem::set_fast_seek(bool enable)
+{
+    lock();
+    _fast_seek = enable;
+    unlock();
+}
+
+
 ////// Dir operations //////
 int FATFileSystem::dir_open(fs_dir_t *dir, const char *path)
 {
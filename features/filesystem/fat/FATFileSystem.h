@@ -147,6 +147,18 @@ public:
      */
      virtual int statvfs(const char *path, struct statvfs *buf);
 
+    /** Enable fast seeking for files opened after this call
+     *
+     *  Each such file builds a cluster link map table on its first seek, and keeps
+     *  it until it is closed, so seeks no longer follow the FAT chain from the
+     *  start of the file. The table takes 8 bytes per fragment of the file. If
+     *  the file grows past its allocated clusters the table is rebuilt on the
+     *  next seek.
+     *
+     *  @param enable   Whether files opened from now on use fast seeking
+     */
+    void set_fast_seek(bool enable);
+
 protected:
     /** Open a file on the filesystem
      *
@@ -264,6 +276,7 @@ private:
     FATFS _fs; // Work area (file system object) for logical drive
     char _fsid[sizeof("0:")];
     int _id;
+    bool _fast_seek;
 
 protected:
     virtual void lock();
@@ -20,6 +20,12 @@ extern "C" {
 #include "lfs.h"
 #include "lfs_util.h"
 }
+#include "drivers/TableCRC.h"
+
+#if !defined(LFS_NO_CRC_TABLES) && MBED_LFS_CRC_TABLES
+// lfs_crc uses the slicing-by-4 tables of MbedCRC rather than its own copy
+extern "C" const uint32_t (*const lfs_crc_rtable)[MBED_CRC_TABLE_SIZE] = mbed::Table_CRC_32bit_Rev_ANSI;
+#endif
 
 
 ////// Conversion functions //////
@@ -112,12 +118,16 @@ static int lfs_bd_sync(const struct lfs_config *c)
 // Filesystem implementation (See LittleFileSystem.h)
 LittleFileSystem::LittleFileSystem(const char *name, BlockDevice *bd,
         lfs_size_t read_size, lfs_size_t prog_size,
-        lfs_size_t block_size, lfs_size_t lookahead)
+        lfs_size_t block_size, lfs_size_t lookahead,
+        lfs_size_t cache_lines, lfs_size_t index_entries, bool free_map)
         : FileSystem(name)
         , _read_size(read_size)
         , _prog_size(prog_size)
         , _block_size(block_size)
-        , _lookahead(lookahead) {
+        , _lookahead(lookahead)
+        , _cache_lines(cache_lines)
+        , _index_entries(index_entries)
+        , _free_map(free_map) {
     if (bd) {
         mount(bd);
     }
@@ -163,6 +173,9 @@ int LittleFileSystem::mount(BlockDevice *bd)
     if (_config.lookahead > _lookahead) {
         _config.lookahead = _lookahead;
     }
+    _config.cache_lines = _cache_lines;
+    _config.index_entries = _index_entries;
+    _config.free_map = _free_map;
 
     err = lfs_mount(&_lfs, &_config);
     LFS_INFO("mount -> %d", lfs_toerror(err));
@@ -50,12 +50,28 @@ public:
      *      lookahead reduces the number of passes required to allocate a block.
      *      The lookahead buffer requires only 1 bit per block so it can be quite
      *      large with little ram impact. Should be a multiple of 32.
+     *  @param cache_lines
+     *      Number of read sized lines in a least recently used read cache
+     *      shared by all files and metadata. Interleaved reads of several
+     *      files and directories avoid reading the block device again, at
+     *      the cost of a read sized buffer per line.
+     *  @param index_entries
+     *      Number of entries in an in-ram index of recently seen names used
+     *      to resolve paths without scanning the directories again. Costs
+     *      20 bytes per entry.
+     *  @param free_map
+     *      Keep the lookahead buffer as a map of free blocks over the whole
+     *      device, so the filesystem is only traversed when the map runs
+     *      out. Only used if the lookahead is at least the number of blocks.
      */
     LittleFileSystem(const char *name=NULL, BlockDevice *bd=NULL,
             lfs_size_t read_size=MBED_LFS_READ_SIZE,
             lfs_size_t prog_size=MBED_LFS_PROG_SIZE,
             lfs_size_t block_size=MBED_LFS_BLOCK_SIZE,
-            lfs_size_t lookahead=MBED_LFS_LOOKAHEAD);
+            lfs_size_t lookahead=MBED_LFS_LOOKAHEAD,
+            lfs_size_t cache_lines=MBED_LFS_CACHE_LINES,
+            lfs_size_t index_entries=MBED_LFS_INDEX_ENTRIES,
+            bool free_map=MBED_LFS_FREE_MAP);
     virtual ~LittleFileSystem();
     
     /** Formats a block device with the LittleFileSystem
@@ -274,6 +290,9 @@ private:
     const lfs_size_t _prog_size;
     const lfs_size_t _block_size;
     const lfs_size_t _lookahead;
+    const lfs_size_t _cache_lines;
+    const lfs_size_t _index_entries;
+    const bool _free_map;
 
     // thread-safe locking
     PlatformMutex _mutex;
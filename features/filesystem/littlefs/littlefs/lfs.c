@@ -20,6 +20,54 @@
 
 
 /// Caching block device operations ///
+static int lfs_lines_read(lfs_t *lfs, lfs_block_t block,
+        lfs_off_t off, uint8_t *buffer) {
+    lfs_size_t count = lfs->cfg->cache_lines;
+    if (!count) {
+        return lfs->cfg->read(lfs->cfg, block, off,
+                buffer, lfs->cfg->read_size);
+    }
+
+    // lines are kept in most recently used order
+    lfs_size_t i = 0;
+    while (i < count-1 && !(lfs->lines[i].block == block &&
+            lfs->lines[i].off == off)) {
+        i += 1;
+    }
+
+    lfs_cache_t line = lfs->lines[i];
+    if (line.block != block || line.off != off) {
+        // evict the least recently used line
+        line.block = 0xffffffff;
+        int err = lfs->cfg->read(lfs->cfg, block, off,
+                line.buffer, lfs->cfg->read_size);
+        if (err) {
+            lfs->lines[i] = line;
+            return err;
+        }
+
+        line.block = block;
+        line.off = off;
+    }
+
+    memmove(&lfs->lines[1], &lfs->lines[0], i*sizeof(lfs_cache_t));
+    lfs->lines[0] = line;
+    memcpy(buffer, line.buffer, lfs->cfg->read_size);
+    return 0;
+}
+
+static void lfs_lines_drop(lfs_t *lfs, lfs_block_t block,
+        lfs_off_t off, lfs_size_t size) {
+    // drop lines overlapping a program or erase
+    for (lfs_size_t i = 0; i < lfs->cfg->cache_lines; i++) {
+        if (lfs->lines[i].block == block &&
+                lfs->lines[i].off + lfs->cfg->read_size > off &&
+                lfs->lines[i].off < off + size) {
+            lfs->lines[i].block = 0xffffffff;
+        }
+    }
+}
+
 static int lfs_cache_read(lfs_t *lfs, lfs_cache_t *rcache,
         const lfs_cache_t *pcache, lfs_block_t block,
         lfs_off_t off, void *buffer, lfs_size_t size) {
@@ -70,8 +118,8 @@ static int lfs_cache_read(lfs_t *lfs, lfs_cache_t *rcache,
         // load to cache, first condition can no longer fail
         rcache->block = block;
         rcache->off = off - (off % lfs->cfg->read_size);
-        int err = lfs->cfg->read(lfs->cfg, rcache->block,
-                rcache->off, rcache->buffer, lfs->cfg->read_size);
+        int err = lfs_lines_read(lfs, rcache->block,
+                rcache->off, rcache->buffer);
         if (err) {
             return err;
         }
@@ -104,15 +152,21 @@ static int lfs_cache_cmp(lfs_t *lfs, lfs_cache_t *rcache,
 static int lfs_cache_crc(lfs_t *lfs, lfs_cache_t *rcache,
         const lfs_cache_t *pcache, lfs_block_t block,
         lfs_off_t off, lfs_size_t size, uint32_t *crc) {
-    for (lfs_off_t i = 0; i < size; i++) {
-        uint8_t c;
+    // checksum in word aligned chunks instead of byte by byte
+    uint32_t data[8];
+
+    while (size > 0) {
+        lfs_size_t diff = lfs_min(size, sizeof(data));
         int err = lfs_cache_read(lfs, rcache, pcache,
-                block, off+i, &c, 1);
+                block, off, data, diff);
         if (err) {
             return err;
         }
 
-        lfs_crc(crc, &c, 1);
+        lfs_crc(crc, data, diff);
+
+        off += diff;
+        size -= diff;
     }
 
     return 0;
@@ -121,6 +175,7 @@ static int lfs_cache_crc(lfs_t *lfs, lfs_cache_t *rcache,
 static int lfs_cache_flush(lfs_t *lfs,
         lfs_cache_t *pcache, lfs_cache_t *rcache) {
     if (pcache->block != 0xffffffff) {
+        lfs_lines_drop(lfs, pcache->block, pcache->off, lfs->cfg->prog_size);
         int err = lfs->cfg->prog(lfs->cfg, pcache->block,
                 pcache->off, pcache->buffer, lfs->cfg->prog_size);
         if (err) {
@@ -182,6 +237,7 @@ static int lfs_cache_prog(lfs_t *lfs, lfs_cache_t *pcache,
                 size >= lfs->cfg->prog_size) {
             // bypass pcache?
             lfs_size_t diff = size - (size % lfs->cfg->prog_size);
+            lfs_lines_drop(lfs, block, off, diff);
             int err = lfs->cfg->prog(lfs->cfg, block, off, data, diff);
             if (err) {
                 return err;
@@ -240,6 +296,7 @@ static int lfs_bd_crc(lfs_t *lfs, lfs_block_t block,
 }
 
 static int lfs_bd_erase(lfs_t *lfs, lfs_block_t block) {
+    lfs_lines_drop(lfs, block, 0, lfs->cfg->block_size);
     return lfs->cfg->erase(lfs->cfg, block);
 }
 
@@ -280,7 +337,78 @@ static int lfs_alloc_lookahead(void *p, lfs_block_t block) {
     return 0;
 }
 
+static int lfs_alloc_free(void *p, lfs_block_t block) {
+    lfs_t *lfs = p;
+
+    if (block < lfs->cfg->block_count) {
+        lfs->free.buffer[block / 32] &= ~(1U << (block % 32));
+    }
+
+    return 0;
+}
+
+static bool lfs_alloc_ismap(lfs_t *lfs) {
+    // with free_map a lookahead covering the whole device is kept as a
+    // map of free blocks, allocated blocks are marked in it as they are
+    // handed out and removed files and directories are unmarked, so we
+    // only need to traverse the filesystem once the map runs out
+    return lfs->cfg->free_map &&
+            lfs->cfg->lookahead >= lfs->cfg->block_count;
+}
+
+static int lfs_alloc_map(lfs_t *lfs, lfs_block_t *block) {
+    for (int pass = 0; pass < 2; pass++) {
+        // scan the whole map, starting after the last allocated block
+        for (lfs_block_t i = 0; lfs->free.size && i < lfs->cfg->block_count;) {
+            lfs_block_t off = (lfs->free.index + i) % lfs->cfg->block_count;
+            if (off % 32 == 0 && off + 32 <= lfs->cfg->block_count &&
+                    lfs->free.buffer[off / 32] == 0xffffffff) {
+                i += 32;
+                continue;
+            }
+
+            i += 1;
+            if (!(lfs->free.buffer[off / 32] & (1U << (off % 32)))) {
+                // found a free block
+                lfs->free.buffer[off / 32] |= 1U << (off % 32);
+                lfs->free.index = (off + 1) % lfs->cfg->block_count;
+                lfs->free.ack -= lfs_min(i, lfs->free.ack);
+                *block = off;
+                return 0;
+            }
+        }
+
+        if (pass > 0) {
+            break;
+        }
+
+        // find mask of free blocks from tree
+        memset(lfs->free.buffer, 0, lfs->cfg->lookahead/8);
+        lfs->free.off = 0;
+        lfs->free.size = lfs->cfg->block_count;
+        int err = lfs_traverse(lfs, lfs_alloc_lookahead, lfs);
+        if (err) {
+            lfs->free.size = 0;
+            return err;
+        }
+
+        // blocks allocated since the last ack are not in the tree yet,
+        // they are somewhere in the range we scanned since then
+        for (lfs_block_t i = lfs->free.ack; i < lfs->cfg->block_count; i++) {
+            lfs_block_t off = (lfs->free.index + i) % lfs->cfg->block_count;
+            lfs->free.buffer[off / 32] |= 1U << (off % 32);
+        }
+    }
+
+    LFS_WARN("No more free space %ld", lfs->free.index);
+    return LFS_ERR_NOSPC;
+}
+
 static int lfs_alloc(lfs_t *lfs, lfs_block_t *block) {
+    if (lfs_alloc_ismap(lfs)) {
+        return lfs_alloc_map(lfs, block);
+    }
+
     while (true) {
         while (lfs->free.index != lfs->free.size) {
             lfs_block_t off = lfs->free.index;
@@ -490,8 +618,17 @@ struct lfs_region {
     lfs_size_t newlen;
 };
 
+static void lfs_index_clear(lfs_t *lfs) {
+    for (lfs_size_t i = 0; i < lfs->cfg->index_entries; i++) {
+        lfs->index[i].head = 0xffffffff;
+    }
+}
+
 static int lfs_dir_commit(lfs_t *lfs, lfs_dir_t *dir,
         const struct lfs_region *regions, int count) {
+    // entries may move, drop the name index
+    lfs_index_clear(lfs);
+
     // increment revision count
     dir->d.rev += 1;
 
@@ -545,14 +682,21 @@ static int lfs_dir_commit(lfs_t *lfs, lfs_dir_t *dir,
                     newoff += regions[i].newlen;
                     i += 1;
                 } else {
-                    uint8_t data;
-                    err = lfs_bd_read(lfs, oldpair[1], oldoff, &data, 1);
+                    // copy old data up to the next region in chunks
+                    uint32_t data[8];
+                    lfs_size_t diff = lfs_min(sizeof(data),
+                            (0x7fffffff & dir->d.size)-4 - newoff);
+                    if (i < count) {
+                        diff = lfs_min(diff, regions[i].oldoff - oldoff);
+                    }
+
+                    err = lfs_bd_read(lfs, oldpair[1], oldoff, data, diff);
                     if (err) {
                         return err;
                     }
 
-                    lfs_crc(&crc, &data, 1);
-                    err = lfs_bd_prog(lfs, dir->pair[0], newoff, &data, 1);
+                    lfs_crc(&crc, data, diff);
+                    err = lfs_bd_prog(lfs, dir->pair[0], newoff, data, diff);
                     if (err) {
                         if (err == LFS_ERR_CORRUPT) {
                             goto relocate;
@@ -560,8 +704,8 @@ static int lfs_dir_commit(lfs_t *lfs, lfs_dir_t *dir,
                         return err;
                     }
 
-                    oldoff += 1;
-                    newoff += 1;
+                    oldoff += diff;
+                    newoff += diff;
                 }
             }
 
@@ -779,6 +923,90 @@ static int lfs_dir_next(lfs_t *lfs, lfs_dir_t *dir, lfs_entry_t *entry) {
     return 0;
 }
 
+static int lfs_index_find(lfs_t *lfs, lfs_dir_t *dir, lfs_entry_t *entry,
+        lfs_block_t head, const char *name, lfs_size_t len) {
+    if (!lfs->cfg->index_entries) {
+        return false;
+    }
+
+    // names are hashed with the directory they are in
+    uint32_t hash = head;
+    lfs_crc(&hash, name, len);
+    lfs_index_t *index = &lfs->index[hash % lfs->cfg->index_entries];
+    if (index->head != head || index->hash != hash) {
+        return false;
+    }
+
+    // the index is cleared on every commit, so the pair was checked when
+    // the entry was added and only the header needs to be read again,
+    // the caller's dir and entry are only updated on a confirmed match
+    // as a miss falls back to the entry's directory
+    lfs_dir_t idir;
+    lfs_entry_t ientry;
+    int err = lfs_bd_read(lfs, index->pair[0], 0, &idir.d, sizeof(idir.d));
+    lfs_dir_fromle32(&idir.d);
+    if (err) {
+        return err;
+    }
+
+    if (index->off + sizeof(ientry.d) > (0x7fffffff & idir.d.size)-4) {
+        return false;
+    }
+
+    idir.pair[0] = index->pair[0];
+    idir.pair[1] = index->pair[1];
+    idir.off = index->off;
+    idir.pos = 0;
+    err = lfs_dir_next(lfs, &idir, &ientry);
+    if (err) {
+        return err;
+    }
+
+    if (((0xff & ientry.d.type) != LFS_TYPE_REG &&
+         (0xff & ientry.d.type) != LFS_TYPE_DIR) ||
+        ientry.d.nlen != len) {
+        return false;
+    }
+
+    int res = lfs_bd_cmp(lfs, idir.pair[0],
+            ientry.off + 4+ientry.d.elen+ientry.d.alen, name, len);
+    if (res <= 0) {
+        return res;
+    }
+
+    // only what lfs_dir_fetch would have set, dir may be in the open list
+    dir->pair[0] = idir.pair[0];
+    dir->pair[1] = idir.pair[1];
+    dir->off = idir.off;
+    dir->d = idir.d;
+    *entry = ientry;
+    return true;
+}
+
+static int lfs_index_add(lfs_t *lfs, const lfs_dir_t *dir,
+        const lfs_entry_t *entry, lfs_block_t head) {
+    if ((0xff & entry->d.type) != LFS_TYPE_REG &&
+        (0xff & entry->d.type) != LFS_TYPE_DIR) {
+        return 0;
+    }
+
+    uint32_t hash = head;
+    int err = lfs_bd_crc(lfs, dir->pair[0],
+            entry->off + 4+entry->d.elen+entry->d.alen,
+            entry->d.nlen, &hash);
+    if (err) {
+        return err;
+    }
+
+    lfs_index_t *index = &lfs->index[hash % lfs->cfg->index_entries];
+    index->head = head;
+    index->hash = hash;
+    index->pair[0] = dir->pair[0];
+    index->pair[1] = dir->pair[1];
+    index->off = entry->off;
+    return 0;
+}
+
 static int lfs_dir_find(lfs_t *lfs, lfs_dir_t *dir,
         lfs_entry_t *entry, const char **path) {
     const char *pathname = *path;
@@ -840,6 +1068,18 @@ nextname:
             return LFS_ERR_NOTDIR;
         }
 
+        // look for the name in the index first
+        lfs_block_t head = entry->d.u.dir[0];
+        int res = lfs_index_find(lfs, dir, entry, head, pathname, pathlen);
+        if (res < 0) {
+            return res;
+        }
+
+        if (res) {
+            pathname += pathlen;
+            continue;
+        }
+
         int err = lfs_dir_fetch(lfs, dir, entry->d.u.dir);
         if (err) {
             return err;
@@ -852,6 +1092,13 @@ nextname:
                 return err;
             }
 
+            if (lfs->cfg->index_entries) {
+                err = lfs_index_add(lfs, dir, entry, head);
+                if (err) {
+                    return err;
+                }
+            }
+
             if (((0x7f & entry->d.type) != LFS_TYPE_REG &&
                  (0x7f & entry->d.type) != LFS_TYPE_DIR) ||
                 entry->d.nlen != pathlen) {
@@ -1849,6 +2096,24 @@ int lfs_remove(lfs_t *lfs, const char *path) {
         }
     }
 
+    // blocks of the entry can be returned to the free map, unless
+    // they are still in use by an open file or directory
+    bool release = lfs_alloc_ismap(lfs) && lfs->free.size &&
+            (entry.d.type == LFS_TYPE_REG || entry.d.type == LFS_TYPE_DIR);
+    for (lfs_file_t *f = lfs->files; f; f = f->next) {
+        if (lfs_paircmp(f->pair, cwd.pair) == 0 && f->poff == entry.off) {
+            release = false;
+        }
+    }
+
+    if (entry.d.type == LFS_TYPE_DIR) {
+        for (lfs_dir_t *d = lfs->dirs; d; d = d->next) {
+            if (lfs_paircmp(d->pair, dir.pair) == 0) {
+                release = false;
+            }
+        }
+    }
+
     // remove the entry
     err = lfs_dir_remove(lfs, &cwd, &entry);
     if (err) {
@@ -1872,6 +2137,18 @@ int lfs_remove(lfs_t *lfs, const char *path) {
         }
     }
 
+    if (release) {
+        // blocks we fail to reach are found by the next traversal
+        if (entry.d.type == LFS_TYPE_DIR) {
+            lfs_alloc_free(lfs, dir.pair[0]);
+            lfs_alloc_free(lfs, dir.pair[1]);
+        } else {
+            lfs_ctz_traverse(lfs, &lfs->rcache, NULL,
+                    entry.d.u.file.head, entry.d.u.file.size,
+                    lfs_alloc_free, lfs);
+        }
+    }
+
     return 0;
 }
 
@@ -2009,6 +2286,33 @@ static int lfs_init(lfs_t *lfs, const struct lfs_config *cfg) {
         }
     }
 
+    // setup name index
+    lfs->index = NULL;
+    if (lfs->cfg->index_entries) {
+        lfs->index = lfs_malloc(lfs->cfg->index_entries*sizeof(lfs_index_t));
+        if (!lfs->index) {
+            return LFS_ERR_NOMEM;
+        }
+
+        lfs_index_clear(lfs);
+    }
+
+    // setup lines of the shared read cache
+    lfs->lines = NULL;
+    if (lfs->cfg->cache_lines) {
+        lfs->lines = lfs_malloc(lfs->cfg->cache_lines *
+                (sizeof(lfs_cache_t) + lfs->cfg->read_size));
+        if (!lfs->lines) {
+            return LFS_ERR_NOMEM;
+        }
+
+        uint8_t *buffer = (uint8_t*)&lfs->lines[lfs->cfg->cache_lines];
+        for (lfs_size_t i = 0; i < lfs->cfg->cache_lines; i++) {
+            lfs->lines[i].block = 0xffffffff;
+            lfs->lines[i].buffer = &buffer[i*lfs->cfg->read_size];
+        }
+    }
+
     // setup lookahead, round down to nearest 32-bits
     LFS_ASSERT(lfs->cfg->lookahead % 32 == 0);
     LFS_ASSERT(lfs->cfg->lookahead > 0);
@@ -2053,6 +2357,9 @@ static int lfs_deinit(lfs_t *lfs) {
         lfs_free(lfs->free.buffer);
     }
 
+    lfs_free(lfs->lines);
+    lfs_free(lfs->index);
+
     return 0;
 }
 
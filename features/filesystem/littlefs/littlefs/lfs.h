@@ -171,6 +171,23 @@ struct lfs_config {
     // Optional, statically allocated buffer for files. Must be program sized.
     // If enabled, only one file may be opened at a time.
     void *file_buffer;
+
+    // Optional number of read sized lines in a least recently used cache
+    // shared by all reads, behind the read and file caches. Lets interleaved
+    // reads of files and metadata avoid reading the same data again. Lines
+    // are allocated with lfs_malloc.
+    lfs_size_t cache_lines;
+
+    // Optional number of entries in an in-RAM index of names, filled in as
+    // directories are scanned, so following lookups of those names don't
+    // need to scan the directory again. The index is cleared on every
+    // directory commit. Entries are allocated with lfs_malloc.
+    lfs_size_t index_entries;
+
+    // Optional, keep the lookahead buffer as a map of free blocks over the
+    // whole device, so the filesystem is only traversed once the map runs
+    // out. Only used if the lookahead is at least the block count.
+    bool free_map;
 };
 
 
@@ -212,6 +229,13 @@ typedef struct lfs_cache {
     uint8_t *buffer;
 } lfs_cache_t;
 
+typedef struct lfs_index {
+    lfs_block_t head;
+    uint32_t hash;
+    lfs_block_t pair[2];
+    lfs_off_t off;
+} lfs_index_t;
+
 typedef struct lfs_file {
     struct lfs_file *next;
     lfs_block_t pair[2];
@@ -276,6 +300,8 @@ typedef struct lfs {
 
     lfs_cache_t rcache;
     lfs_cache_t pcache;
+    lfs_cache_t *lines;
+    lfs_index_t *index;
 
     lfs_free_t free;
     bool deorphaned;
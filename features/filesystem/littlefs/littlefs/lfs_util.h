@@ -47,6 +47,7 @@
 #define MBED_LFS_ENABLE_ERROR  true
 #define MBED_LFS_ENABLE_ASSERT true
 #define MBED_LFS_INTRINSICS    true
+#define MBED_LFS_CRC_TABLES    true
 #endif
 
 // Logging functions
@@ -177,6 +178,7 @@ static inline uint32_t lfs_tole32(uint32_t a) {
 }
 
 // Calculate CRC-32 with polynomial = 0x04c11db7
+// LFS_NO_CRC_TABLES falls back to a nibble table, trading speed for 4KB of ROM
 void lfs_crc(uint32_t *crc, const void *buffer, size_t size);
 
 // Allocate memory, only used if buffers are not provided to littlefs
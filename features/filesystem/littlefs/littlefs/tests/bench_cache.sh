@@ -0,0 +1,56 @@
+#!/bin/bash
+set -eu
+
+# Compares block device reads and time on emubd for interleaved reads of
+# several files, with different numbers of shared read cache lines
+echo "=== Read cache benchmark ==="
+rm -rf blocks
+tests/test.py << TEST
+    lfs_format(&lfs, &cfg) => 0;
+    lfs_mount(&lfs, &cfg) => 0;
+    lfs_mkdir(&lfs, "bench") => 0;
+    for (int n = 0; n < 2; n++) {
+        sprintf((char*)buffer, "bench/file%d", n);
+        lfs_file_open(&lfs, &file[0], (char*)buffer,
+                LFS_O_WRONLY | LFS_O_CREAT) => 0;
+        for (int i = 0; i < 1024; i++) {
+            lfs_file_write(&lfs, &file[0], &i, sizeof(i)) => sizeof(i);
+        }
+        lfs_file_close(&lfs, &file[0]) => 0;
+    }
+    lfs_unmount(&lfs) => 0;
+TEST
+
+for lines in 0 4 16 64
+do
+echo "--- $lines cache lines ---"
+tests/test.py << TEST
+    struct lfs_config ccfg = cfg;
+    ccfg.cache_lines = $lines;
+    lfs_mount(&lfs, &ccfg) => 0;
+    lfs_file_open(&lfs, &file[0], "bench/file0", LFS_O_RDONLY) => 0;
+    lfs_file_open(&lfs, &file[1], "bench/file1", LFS_O_RDONLY) => 0;
+
+    // records from a hot set of both files, interleaved with metadata
+    uintmax_t reads = bd.stats.read_count;
+    clock_t start = clock();
+    uint32_t seed = 1;
+    for (int i = 0; i < 2000; i++) {
+        seed = seed*1103515245 + 12345;
+        int record = (seed >> 16) % 256;
+        lfs_file_seek(&lfs, &file[i % 2], record*4,
+                LFS_SEEK_SET) => record*4;
+        lfs_file_read(&lfs, &file[i % 2], buffer, 4) => 4;
+        memcmp(buffer, &record, 4) => 0;
+        if (i % 16 == 0) {
+            lfs_stat(&lfs, "bench/file1", &info) => 0;
+        }
+    }
+    test_log("reads", bd.stats.read_count - reads);
+    test_log("us", (clock() - start) * 1000000 / CLOCKS_PER_SEC);
+
+    lfs_file_close(&lfs, &file[0]) => 0;
+    lfs_file_close(&lfs, &file[1]) => 0;
+    lfs_unmount(&lfs) => 0;
+TEST
+done
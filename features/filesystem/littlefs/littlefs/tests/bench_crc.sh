@@ -0,0 +1,51 @@
+#!/bin/bash
+set -eu
+
+# Compares mount, directory fetch and commit times on emubd with and
+# without the CRC tables, the on-disk format is the same for both
+echo "=== CRC benchmark ==="
+for flags in -DLFS_NO_CRC_TABLES ""
+do
+echo "--- ${flags:-CRC tables} ---"
+make -s clean
+rm -rf blocks
+CFLAGS="$flags" tests/test.py << TEST
+    lfs_format(&lfs, &cfg) => 0;
+    lfs_mount(&lfs, &cfg) => 0;
+    lfs_mkdir(&lfs, "bench") => 0;
+    for (int i = 0; i < 40; i++) {
+        sprintf((char*)buffer, "bench/file%03d", i);
+        lfs_file_open(&lfs, &file[0], (char*)buffer,
+                LFS_O_WRONLY | LFS_O_CREAT) => 0;
+        lfs_file_close(&lfs, &file[0]) => 0;
+    }
+    lfs_unmount(&lfs) => 0;
+
+    clock_t start = clock();
+    for (int i = 0; i < 200; i++) {
+        lfs_mount(&lfs, &cfg) => 0;
+        lfs_unmount(&lfs) => 0;
+    }
+    test_log("mount us", (clock() - start) * 1000000 / CLOCKS_PER_SEC / 200);
+
+    lfs_mount(&lfs, &cfg) => 0;
+    start = clock();
+    for (int i = 0; i < 200; i++) {
+        sprintf((char*)buffer, "bench/file%03d", i % 40);
+        lfs_stat(&lfs, (char*)buffer, &info) => 0;
+    }
+    test_log("fetch us", (clock() - start) * 1000000 / CLOCKS_PER_SEC / 200);
+
+    start = clock();
+    for (int i = 0; i < 200; i++) {
+        sprintf((char*)buffer, "bench/file%03d", i % 40);
+        lfs_file_open(&lfs, &file[0], (char*)buffer,
+                LFS_O_WRONLY | LFS_O_APPEND) => 0;
+        lfs_file_write(&lfs, &file[0], buffer, 1) => 1;
+        lfs_file_close(&lfs, &file[0]) => 0;
+    }
+    test_log("commit us", (clock() - start) * 1000000 / CLOCKS_PER_SEC / 200);
+    lfs_unmount(&lfs) => 0;
+TEST
+done
+make -s clean
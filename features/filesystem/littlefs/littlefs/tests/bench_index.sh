@@ -0,0 +1,43 @@
+#!/bin/bash
+set -eu
+
+# Compares block device reads and time on emubd for path lookups in a
+# large directory, with and without the name index
+echo "=== Name index benchmark ==="
+rm -rf blocks
+tests/test.py << TEST
+    lfs_format(&lfs, &cfg) => 0;
+    lfs_mount(&lfs, &cfg) => 0;
+    lfs_mkdir(&lfs, "bench") => 0;
+    for (int n = 0; n < 200; n++) {
+        sprintf((char*)buffer, "bench/file%03d", n);
+        lfs_file_open(&lfs, &file[0], (char*)buffer,
+                LFS_O_WRONLY | LFS_O_CREAT) => 0;
+        lfs_file_close(&lfs, &file[0]) => 0;
+    }
+    lfs_unmount(&lfs) => 0;
+TEST
+
+for entries in 0 256
+do
+echo "--- $entries index entries ---"
+tests/test.py << TEST
+    struct lfs_config icfg = cfg;
+    icfg.index_entries = $entries;
+    lfs_mount(&lfs, &icfg) => 0;
+
+    // lookups of files spread over the whole directory
+    uintmax_t reads = bd.stats.read_count;
+    clock_t start = clock();
+    uint32_t seed = 1;
+    for (int i = 0; i < 1000; i++) {
+        seed = seed*1103515245 + 12345;
+        sprintf((char*)buffer, "bench/file%03d", (int)((seed >> 16) % 200));
+        lfs_stat(&lfs, (char*)buffer, &info) => 0;
+    }
+    test_log("reads", bd.stats.read_count - reads);
+    test_log("us", (clock() - start) * 1000000 / CLOCKS_PER_SEC);
+
+    lfs_unmount(&lfs) => 0;
+TEST
+done
@@ -424,5 +424,75 @@ tests/test.py << TEST
     lfs_unmount(&lfs) => 0;
 TEST
 
+echo "--- Free map test ---"
+rm -rf blocks
+tests/test.py << TEST
+    struct lfs_config cfgs[2] = {cfg, cfg};
+    cfgs[0].read = test_read;
+    cfgs[1].read = test_read;
+    // a window well below the block count, whatever LFS_LOOKAHEAD is
+    cfgs[0].lookahead = 128;
+    cfgs[0].free_map = false;
+    cfgs[1].lookahead = 32*((cfg.block_count+31)/32);
+    cfgs[1].free_map = true;
+    uintmax_t reads[2];
+    uintmax_t roots[2];
+
+    memset(wbuffer, 'c', sizeof(wbuffer));
+    for (int c = 0; c < 2; c++) {
+        lfs_format(&lfs, &cfgs[c]) => 0;
+        lfs_mount(&lfs, &cfgs[c]) => 0;
+
+        // data that every traversal has to go through
+        lfs_file_open(&lfs, &file[0], "resident",
+                LFS_O_WRONLY | LFS_O_CREAT) => 0;
+        for (int i = 0; i < 256; i++) {
+            lfs_file_write(&lfs, &file[0], wbuffer, 512) => 512;
+        }
+        lfs_file_close(&lfs, &file[0]) => 0;
+
+        // keep replacing files, only a lookahead window needs traversals
+        reads[c] = bd.stats.read_count;
+        roots[c] = test_root_reads;
+        for (int i = 0; i < 64; i++) {
+            sprintf((char*)buffer, "churn%d", i % 2);
+            lfs_remove(&lfs, (char*)buffer) => (i < 2) ? LFS_ERR_NOENT : 0;
+            lfs_file_open(&lfs, &file[0], (char*)buffer,
+                    LFS_O_WRONLY | LFS_O_CREAT) => 0;
+            for (int j = 0; j < 32; j++) {
+                lfs_file_write(&lfs, &file[0], wbuffer, 512) => 512;
+            }
+            lfs_file_close(&lfs, &file[0]) => 0;
+        }
+        reads[c] = bd.stats.read_count - reads[c];
+        roots[c] = test_root_reads - roots[c];
+        lfs_unmount(&lfs) => 0;
+    }
+
+    test_log("window reads", reads[0]);
+    test_log("window root reads", roots[0]);
+    test_log("map reads", reads[1]);
+    test_log("map root reads", roots[1]);
+    (roots[1] < roots[0]/4) => 1;
+    (reads[1] < reads[0]) => 1;
+TEST
+tests/test.py << TEST
+    struct lfs_config mcfg = cfg;
+    mcfg.lookahead = 32*((cfg.block_count+31)/32);
+    mcfg.free_map = true;
+    lfs_mount(&lfs, &mcfg) => 0;
+    memset(wbuffer, 'c', sizeof(wbuffer));
+    const char *names[] = {"resident", "churn0", "churn1"};
+    for (int n = 0; n < 3; n++) {
+        lfs_file_open(&lfs, &file[0], names[n], LFS_O_RDONLY) => 0;
+        lfs_file_size(&lfs, &file[0]) => (n == 0) ? 256*512 : 32*512;
+        while ((size = lfs_file_read(&lfs, &file[0], rbuffer, 512)) > 0) {
+            memcmp(rbuffer, wbuffer, size) => 0;
+        }
+        lfs_file_close(&lfs, &file[0]) => 0;
+    }
+    lfs_unmount(&lfs) => 0;
+TEST
+
 echo "--- Results ---"
 tests/stats.py
@@ -139,5 +139,32 @@ tests/test.py << TEST
     lfs_unmount(&lfs) => 0;
 TEST
 
+echo "--- Name index collision tests ---"
+tests/test.py << TEST
+    // these names have the same crc in any directory, so they share a
+    // name index entry
+    struct lfs_config icfg = cfg;
+    icfg.index_entries = 16;
+    lfs_mount(&lfs, &icfg) => 0;
+    lfs_mkdir(&lfs, "clash") => 0;
+    lfs_file_open(&lfs, &file[0], "clash/aaaaaaPa",
+            LFS_O_WRONLY | LFS_O_CREAT) => 0;
+    lfs_file_write(&lfs, &file[0], "a", 1) => 1;
+    lfs_file_close(&lfs, &file[0]) => 0;
+    lfs_mkdir(&lfs, "clash/naaa7q39") => 0;
+    lfs_mkdir(&lfs, "clash/naaa7q39/cup") => 0;
+
+    for (int i = 0; i < 2; i++) {
+        lfs_stat(&lfs, "clash/aaaaaaPa", &info) => 0;
+        info.type => LFS_TYPE_REG;
+        info.size => 1;
+        lfs_stat(&lfs, "clash/naaa7q39", &info) => 0;
+        info.type => LFS_TYPE_DIR;
+        lfs_stat(&lfs, "clash/naaa7q39/cup", &info) => 0;
+        info.type => LFS_TYPE_DIR;
+    }
+    lfs_unmount(&lfs) => 0;
+TEST
+
 echo "--- Results ---"
 tests/stats.py
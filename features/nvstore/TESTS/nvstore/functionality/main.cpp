@@ -37,6 +37,18 @@ static const uint16_t max_test_keys = 20;
 
 static const size_t basic_func_max_data_size = 128;
 
+static const int sparse_test_num_keys = 8;
+// The dense key index takes 4 bytes per key, so limit the key range unless the compact index is used
+static const uint16_t sparse_test_dense_max_keys = 256;
+static const int sparse_test_data_size = 8;
+
+static const int gc_test_num_keys = 10;
+static const int gc_test_data_size = 24;
+static const int gc_test_step_records = 1;
+
+static const int batch_test_num_keys = 40;
+static const int batch_test_data_size = 8;
+
 static const int thr_test_num_buffs = 5;
 static const int thr_test_num_secs = 5;
 static const int thr_test_max_data_size = 32;
@@ -350,6 +362,188 @@ static void nvstore_basic_functionality_test()
     delete[] nvstore_testing_buf_get;
 }
 
+static void nvstore_sparse_keys_test()
+{
+    NVStore &nvstore = NVStore::get_instance();
+    uint16_t max_keys, key, actual_len_bytes;
+    uint8_t data[sparse_test_data_size], get_data[sparse_test_data_size];
+    int result;
+
+#if NVSTORE_COMPACT_INDEX
+    max_keys = nvstore.get_max_possible_keys() - 1;
+#else
+    max_keys = std::min((uint16_t)(nvstore.get_max_possible_keys() - 1), sparse_test_dense_max_keys);
+#endif
+    nvstore.set_max_keys(max_keys);
+    TEST_ASSERT_EQUAL(max_keys, nvstore.get_max_keys());
+
+    result = nvstore.reset();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+
+    // Spread a few keys across the whole key range
+    for (key = 1; key < max_keys; key += max_keys / sparse_test_num_keys) {
+        memset(data, (uint8_t) key, sizeof(data));
+        result = nvstore.set(key, sizeof(data), data);
+        TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+    }
+
+    result = nvstore.remove(1);
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+
+    // Make sure index is rebuilt correctly on init
+    result = nvstore.deinit();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+
+    result = nvstore.get(1, sizeof(get_data), get_data, actual_len_bytes);
+    TEST_ASSERT_EQUAL(NVSTORE_NOT_FOUND, result);
+
+    for (key = 1 + max_keys / sparse_test_num_keys; key < max_keys; key += max_keys / sparse_test_num_keys) {
+        memset(data, (uint8_t) key, sizeof(data));
+        result = nvstore.get(key, sizeof(get_data), get_data, actual_len_bytes);
+        TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+        TEST_ASSERT_EQUAL(sizeof(data), actual_len_bytes);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(data, get_data, sizeof(data));
+
+        if (key + 1 < max_keys) {
+            result = nvstore.get(key + 1, sizeof(get_data), get_data, actual_len_bytes);
+            TEST_ASSERT_EQUAL(NVSTORE_NOT_FOUND, result);
+        }
+    }
+
+    nvstore.set_max_keys(max_test_keys);
+    result = nvstore.reset();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+}
+
+static void nvstore_incremental_gc_test()
+{
+    NVStore &nvstore = NVStore::get_instance();
+    uint16_t key, actual_len_bytes;
+    uint8_t data[gc_test_data_size], get_data[gc_test_data_size];
+    nvstore_stats_t stats;
+    int result, i;
+    int gc_started = 0, gc_finished = 0;
+    bool in_progress = false;
+
+    // Incremental mode is off by default
+    nvstore.set_gc_step_records(gc_test_step_records);
+
+    result = nvstore.reset();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+    nvstore.reset_stats();
+
+    // Write enough data to go through a few garbage collections, stepping them from here as well
+    int num_sets = 4 * nvstore.size() / (gc_test_data_size * gc_test_num_keys) * gc_test_num_keys;
+    for (i = 0; i < num_sets; i++) {
+        key = i % gc_test_num_keys;
+        memset(data, (uint8_t) i, sizeof(data));
+        result = nvstore.set(key, sizeof(data), data);
+        TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+        if (i % 3 == 0) {
+            result = nvstore.gc_step();
+            TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+        }
+
+        // Steps copy fewer records than there are keys, so each garbage collection
+        // must be seen in progress between operations
+        if (nvstore.gc_in_progress() != in_progress) {
+            in_progress = !in_progress;
+            if (in_progress) {
+                gc_started++;
+            } else {
+                gc_finished++;
+            }
+        }
+    }
+    TEST_ASSERT(gc_finished >= 2);
+    TEST_ASSERT(gc_started >= gc_finished);
+
+    result = nvstore.deinit();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+
+    for (i = num_sets - gc_test_num_keys; i < num_sets; i++) {
+        key = i % gc_test_num_keys;
+        memset(data, (uint8_t) i, sizeof(data));
+        result = nvstore.get(key, sizeof(get_data), get_data, actual_len_bytes);
+        TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+        TEST_ASSERT_EQUAL(sizeof(data), actual_len_bytes);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(data, get_data, sizeof(data));
+    }
+
+    nvstore.get_stats(stats);
+    printf("Sets %lu, max set latency %luus, garbage collections %lu\n", (unsigned long) stats.set_count,
+           (unsigned long) stats.max_set_latency_us, (unsigned long) stats.gc_count);
+
+    nvstore.set_gc_step_records(NVSTORE_GC_STEP_RECORDS);
+    result = nvstore.reset();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+}
+
+static void nvstore_batch_test()
+{
+    NVStore &nvstore = NVStore::get_instance();
+    nvstore_batch_item_t items[batch_test_num_keys];
+    uint8_t data[batch_test_num_keys][batch_test_data_size], get_data[batch_test_data_size];
+    nvstore_stats_t stats;
+    uint32_t single_programs;
+    uint16_t actual_len_bytes;
+    int result, i;
+
+    nvstore.set_max_keys(batch_test_num_keys + 1);
+    result = nvstore.reset();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+
+    for (i = 0; i < batch_test_num_keys; i++) {
+        gen_random(data[i], batch_test_data_size);
+        items[i].key = i + 1;
+        items[i].size = batch_test_data_size;
+        items[i].buf = data[i];
+    }
+
+    nvstore.reset_stats();
+    for (i = 0; i < batch_test_num_keys; i++) {
+        result = nvstore.set(items[i].key, items[i].size, items[i].buf);
+        TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+    }
+    nvstore.get_stats(stats);
+    single_programs = stats.program_count;
+
+    for (i = 0; i < batch_test_num_keys; i++) {
+        data[i][0]++;
+    }
+
+    nvstore.reset_stats();
+    result = nvstore.set_batch(items, batch_test_num_keys);
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+    nvstore.get_stats(stats);
+#if NVSTORE_STATS_ENABLED
+    printf("%d keys: %lu program operations for single sets, %lu for batch set\n", batch_test_num_keys,
+           (unsigned long) single_programs, (unsigned long) stats.program_count);
+    TEST_ASSERT(stats.program_count < single_programs);
+#else
+    printf("Statistics disabled, not comparing program operations "
+           "(run with --test-config tools/test_configs/NVStoreStats.json)\n");
+#endif
+
+    items[0].key = batch_test_num_keys + 1;
+    result = nvstore.set_batch(items, batch_test_num_keys);
+    TEST_ASSERT_EQUAL(NVSTORE_BAD_VALUE, result);
+    items[0].key = 1;
+
+    result = nvstore.deinit();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+
+    for (i = 0; i < batch_test_num_keys; i++) {
+        result = nvstore.get(items[i].key, sizeof(get_data), get_data, actual_len_bytes);
+        TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+        TEST_ASSERT_EQUAL(batch_test_data_size, actual_len_bytes);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(data[i], get_data, batch_test_data_size);
+    }
+
+    nvstore.set_max_keys(max_test_keys);
+    result = nvstore.reset();
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+}
 
 static void thread_test_check_key(uint16_t key)
 {
@@ -551,6 +745,9 @@ utest::v1::status_t greentea_failure_handler(const Case *const source, const fai
 
 Case cases[] = {
     Case("NVStore: Basic functionality",  nvstore_basic_functionality_test, greentea_failure_handler),
+    Case("NVStore: Sparse keys",          nvstore_sparse_keys_test,         greentea_failure_handler),
+    Case("NVStore: Incremental GC",       nvstore_incremental_gc_test,      greentea_failure_handler),
+    Case("NVStore: Batch set",            nvstore_batch_test,               greentea_failure_handler),
     Case("NVStore: Race test",            nvstore_race_test,                greentea_failure_handler),
     Case("NVStore: Multiple thread test", nvstore_multi_thread_test,        greentea_failure_handler),
 };
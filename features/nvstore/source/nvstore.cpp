@@ -21,9 +21,13 @@
 #if NVSTORE_ENABLED
 
 #include "FlashIAP.h"
+#include "MbedCRC.h"
 #include "mbed_critical.h"
 #include "mbed_assert.h"
 #include "mbed_wait_api.h"
+#if NVSTORE_STATS_ENABLED
+#include "us_ticker_api.h"
+#endif
 #include <algorithm>
 #include <string.h>
 #include <stdio.h>
@@ -34,9 +38,10 @@ static const uint16_t delete_item_flag = 0x8000;
 static const uint16_t set_once_flag    = 0x4000;
 static const uint16_t header_flag_mask = 0xF000;
 
+static const uint16_t batch_record_key  = 0xFFD;
 static const uint16_t master_record_key = 0xFFE;
 static const uint16_t no_key            = 0xFFF;
-static const uint16_t last_reserved_key = master_record_key;
+static const uint16_t last_reserved_key = batch_record_key;
 
 typedef struct
 {
@@ -57,6 +62,15 @@ typedef struct {
     uint32_t reserved2;
 } master_record_data_t;
 
+typedef struct {
+    uint16_t num_items;
+    uint16_t reserved;
+} batch_record_data_t;
+
+// Size of buffer used for packing batch records into program operations
+// (rounded up to the program unit size)
+static const uint32_t batch_prog_buf_size = 256;
+
 static const uint32_t min_area_size = 4096;
 
 static const int num_write_retries = 16;
@@ -92,6 +106,12 @@ typedef enum {
 
 static const uint32_t initial_crc = 0xFFFFFFFF;
 
+#if NVSTORE_COMPACT_INDEX
+// Initial number of compact index entries (must be a power of 2).
+// Index doubles its size when it's more than 3/4 full.
+static const uint32_t index_initial_size = 16;
+#endif
+
 
 // -------------------------------------------------- Local Functions Declaration ----------------------------------------------------
 
@@ -107,7 +127,21 @@ static inline uint32_t align_up(uint32_t val, uint32_t size)
     return (((val - 1) / size) + 1) * size;
 }
 
+#if NVSTORE_COMPACT_INDEX
+// Compact index hash (Fibonacci hashing).
+// Parameters :
+// key           - [IN]   Key.
+// size          - [IN]   Index size (power of 2).
+// Return        : Index position.
+static inline uint32_t index_hash(uint16_t key, uint32_t size)
+{
+    return ((key * 2654435761UL) >> 16) & (size - 1);
+}
+#endif
+
 // CRC32 calculation. Supports "rolling" calculation (using the initial value).
+// Uses the reflected sliced ROM tables of MbedCRC, operating directly on the
+// running (reflected) CRC value, so results match the original bitwise CRC.
 // Parameters :
 // init_crc      - [IN]   Initial CRC.
 // data_size      - [IN]   Buffer's data size.
@@ -115,25 +149,49 @@ static inline uint32_t align_up(uint32_t val, uint32_t size)
 // Return        : CRC.
 static uint32_t crc32(uint32_t init_crc, uint32_t data_size, uint8_t *data_buf)
 {
-    uint32_t i, j;
-    uint32_t crc, mask;
+    mbed::MbedCRC<mbed::POLY_32BIT_ANSI, 32> ct(initial_crc, 0, true, true);
+    uint32_t crc = init_crc;
 
-    crc = init_crc;
-    for (i = 0; i < data_size; i++) {
-        crc = crc ^ (uint32_t) (data_buf[i]);
-        for (j = 0; j < 8; j++) {
-          mask = -(crc & 1);
-          crc = (crc >> 1) ^ (0xEDB88320 & mask);
-        }
-    }
+    ct.compute_partial(data_buf, data_size, &crc);
     return crc;
 }
 
+// Fill a record header (including CRC).
+// Parameters :
+// header        - [OUT]  Record header.
+// key           - [IN]   Record key.
+// flags         - [IN]   Record flags.
+// data_size     - [IN]   Data size.
+// data_buf      - [IN]   Data buffer.
+static void calc_record_header(nvstore_record_header_t &header, uint16_t key, uint16_t flags,
+                               uint32_t data_size, const void *data_buf)
+{
+    uint32_t crc = initial_crc;
+
+    header.key_and_flags = key | flags;
+    header.size = data_size;
+    header.crc = 0; // Satisfy compiler
+    crc = crc32(crc, sizeof(header) - sizeof(header.crc), (uint8_t *) &header);
+    if (data_size) {
+        crc = crc32(crc, data_size, (uint8_t *) data_buf);
+    }
+    header.crc = crc;
+}
+
 NVStore::NVStore() : _init_done(0), _init_attempts(0), _active_area(0), _max_keys(NVSTORE_MAX_KEYS),
-      _active_area_version(0), _free_space_offset(0), _size(0), _mutex(0), _offset_by_key(0), _flash(0),
-      _min_prog_size(0), _page_buf(0)
+      _active_area_version(0), _free_space_offset(0), _size(0), _mutex(0),
+#if NVSTORE_COMPACT_INDEX
+      _index(0), _index_size(0), _index_count(0),
+#else
+      _offset_by_key(0),
+#endif
+      _flash(0), _min_prog_size(0), _page_buf(0), _gc_in_progress(0), _gc_rescan(0), _gc_pos(0),
+      _gc_offset(0), _gc_floor_offset(0), _standby_erase_offset(0), _gc_step_records(NVSTORE_GC_STEP_RECORDS)
 {
     memset(_flash_area_params, 0, sizeof(_flash_area_params));
+#if NVSTORE_STATS_ENABLED
+    memset(&_stats, 0, sizeof(_stats));
+#endif
 }
 
 NVStore::~NVStore()
@@ -163,11 +221,166 @@ void NVStore::set_max_keys(uint16_t num_keys)
 {
     MBED_ASSERT(num_keys < get_max_possible_keys());
     _max_keys = num_keys;
+#if !NVSTORE_COMPACT_INDEX
     // User is allowed to change number of keys. As this affects init, need to deinitialize now.
     // Don't call init right away - it is lazily called by get/set functions if needed.
     deinit();
+#endif
+}
+
+#if NVSTORE_COMPACT_INDEX
+
+void NVStore::index_init()
+{
+    _index_size = index_initial_size;
+    _index_count = 0;
+    _index = new nvstore_index_entry_t[_index_size];
+    MBED_ASSERT(_index);
+    memset(_index, 0, _index_size * sizeof(nvstore_index_entry_t));
+}
+
+void NVStore::index_deinit()
+{
+    delete[] _index;
+    _index = 0;
+    _index_size = 0;
+    _index_count = 0;
+}
+
+uint32_t NVStore::index_get(uint16_t key) const
+{
+    // Linear probing. Offset 0 (master record location) marks an empty entry.
+    for (uint32_t pos = index_hash(key, _index_size); _index[pos].offset;
+         pos = (pos + 1) & (_index_size - 1)) {
+        if (_index[pos].key == key) {
+            return _index[pos].offset;
+        }
+    }
+    return 0;
+}
+
+void NVStore::index_set(uint16_t key, uint32_t offset)
+{
+    uint32_t mask = _index_size - 1;
+    uint32_t pos;
+
+    for (pos = index_hash(key, _index_size); _index[pos].offset; pos = (pos + 1) & mask) {
+        if (_index[pos].key == key) {
+            break;
+        }
+    }
+
+    if (_index[pos].offset && offset) {
+        _index[pos].offset = offset;
+        return;
+    }
+
+    if (!_index[pos].offset) {
+        if (!offset) {
+            return;
+        }
+
+        // Grow index if needed, rehashing all existing entries into the new one
+        if ((_index_count + 1) * 4 > _index_size * 3) {
+            nvstore_index_entry_t *old_index = _index;
+            uint32_t old_size = _index_size;
+
+            _index_size *= 2;
+            _index = new nvstore_index_entry_t[_index_size];
+            MBED_ASSERT(_index);
+            memset(_index, 0, _index_size * sizeof(nvstore_index_entry_t));
+            _index_count = 0;
+            for (uint32_t i = 0; i < old_size; i++) {
+                if (old_index[i].offset) {
+                    index_set(old_index[i].key, old_index[i].offset);
+                }
+            }
+            delete[] old_index;
+            index_set(key, offset);
+            return;
+        }
+
+        _index[pos].key = key;
+        _index[pos].offset = offset;
+        _index_count++;
+        return;
+    }
+
+    // Removal: shift following entries of the probe sequence backwards,
+    // so that no tombstones are needed
+    _index_count--;
+    for (;;) {
+        uint32_t next = pos;
+        _index[pos].offset = 0;
+        for (;;) {
+            next = (next + 1) & mask;
+            if (!_index[next].offset) {
+                return;
+            }
+            uint32_t home = index_hash(_index[next].key, _index_size);
+            // Entry may move back only if its home position isn't cyclically in (pos, next]
+            if ((pos <= next) ? ((pos < home) && (home <= next)) : ((pos < home) || (home <= next))) {
+                continue;
+            }
+            break;
+        }
+        _index[pos] = _index[next];
+        pos = next;
+    }
+}
+
+uint32_t NVStore::index_positions() const
+{
+    return _index_size;
+}
+
+int NVStore::index_key_at(uint32_t pos, uint16_t &key) const
+{
+    key = _index[pos].key;
+    return _index[pos].offset != 0;
+}
+
+#else
+
+void NVStore::index_init()
+{
+    _offset_by_key = new uint32_t[_max_keys];
+    MBED_ASSERT(_offset_by_key);
+
+    for (uint16_t key = 0; key < _max_keys; key++) {
+        _offset_by_key[key] = 0;
+    }
+}
+
+void NVStore::index_deinit()
+{
+    delete[] _offset_by_key;
+    _offset_by_key = 0;
+}
+
+uint32_t NVStore::index_get(uint16_t key) const
+{
+    return _offset_by_key[key];
+}
+
+void NVStore::index_set(uint16_t key, uint32_t offset)
+{
+    _offset_by_key[key] = offset;
+}
+
+uint32_t NVStore::index_positions() const
+{
+    return _max_keys;
+}
+
+int NVStore::index_key_at(uint32_t pos, uint16_t &key) const
+{
+    key = (uint16_t) pos;
+    return _offset_by_key[pos] != 0;
 }
 
+#endif // NVSTORE_COMPACT_INDEX
+
 int NVStore::flash_read_area(uint8_t area, uint32_t offset, uint32_t size, void *buf)
 {
     return _flash->read(buf, _flash_area_params[area].address + offset, size);
@@ -179,6 +392,9 @@ int NVStore::flash_write_area(uint8_t area, uint32_t offset, uint32_t size, cons
     // On some boards, write action can fail due to HW limitations (like critical drivers
     // that disable all other actions). Just retry a few times until success.
     for (int i = 0; i < num_write_retries; i++) {
+#if NVSTORE_STATS_ENABLED
+        _stats.program_count++;
+#endif
         ret = _flash->program(buf, _flash_area_params[area].address + offset, size);
         if (!ret) {
             return ret;
@@ -189,12 +405,17 @@ int NVStore::flash_write_area(uint8_t area, uint32_t offset, uint32_t size, cons
 }
 
 int NVStore::flash_erase_area(uint8_t area)
+{
+    return flash_erase_sectors(area, 0, _flash_area_params[area].size);
+}
+
+int NVStore::flash_erase_sectors(uint8_t area, uint32_t offset, uint32_t size)
 {
     int ret;
     // On some boards, write action can fail due to HW limitations (like critical drivers
     // that disable all other actions). Just retry a few times until success.
     for (int i = 0; i < num_write_retries; i++) {
-        ret = _flash->erase(_flash_area_params[area].address, _flash_area_params[area].size);
+        ret = _flash->erase(_flash_area_params[area].address + offset, size);
         if (!ret) {
             return ret;
         }
@@ -327,7 +548,7 @@ int NVStore::read_record(uint8_t area, uint32_t offset, uint16_t buf_size, void
     key   = header.key_and_flags & ~header_flag_mask;
     flags = header.key_and_flags & header_flag_mask;
 
-    if ((key >= _max_keys) && (key != master_record_key)) {
+    if ((key >= _max_keys) && (key != master_record_key) && (key != batch_record_key)) {
         valid = 0;
         return NVSTORE_SUCCESS;
     }
@@ -377,18 +598,10 @@ int NVStore::write_record(uint8_t area, uint32_t offset, uint16_t key, uint16_t
                           uint32_t data_size, const void *data_buf, uint32_t &next_offset)
 {
     nvstore_record_header_t header;
-    uint32_t crc = initial_crc;
     int os_ret;
     uint8_t *prog_buf;
 
-    header.key_and_flags = key | flags;
-    header.size = data_size;
-    header.crc = 0; // Satisfy compiler
-    crc = crc32(crc, sizeof(header) - sizeof(header.crc), (uint8_t *) &header);
-    if (data_size) {
-        crc = crc32(crc, data_size, (uint8_t *) data_buf);
-    }
-    header.crc = crc;
+    calc_record_header(header, key, flags, data_size, data_buf);
 
     // In case page size is greater than header size, we can't write header and data
     // separately. Instead, we need to copy header and start of data to our page buffer
@@ -439,6 +652,106 @@ int NVStore::write_master_record(uint8_t area, uint16_t version, uint32_t &next_
                         &master_rec, next_offset);
 }
 
+int NVStore::batch_append(uint8_t area, uint32_t &offset, uint8_t *prog_buf, uint32_t prog_buf_size,
+                          uint32_t &fill, const void *data, uint32_t size)
+{
+    const uint8_t *src = (const uint8_t *) data;
+    uint32_t chunk_size;
+
+    while (size) {
+        chunk_size = std::min(size, prog_buf_size - fill);
+        memcpy(prog_buf + fill, src, chunk_size);
+        fill += chunk_size;
+        src += chunk_size;
+        size -= chunk_size;
+        if (fill == prog_buf_size) {
+            if (flash_write_area(area, offset, prog_buf_size, prog_buf)) {
+                return NVSTORE_WRITE_ERROR;
+            }
+            offset += prog_buf_size;
+            fill = 0;
+        }
+    }
+    return NVSTORE_SUCCESS;
+}
+
+int NVStore::write_batch(uint8_t area, uint32_t offset, const nvstore_batch_item_t *items,
+                         uint16_t num_items)
+{
+    nvstore_record_header_t header;
+    batch_record_data_t batch_rec;
+    uint32_t prog_buf_size = align_up(batch_prog_buf_size, _min_prog_size);
+    uint32_t fill = 0;
+    int ret = NVSTORE_SUCCESS;
+
+    // Records are packed one after the other (each aligned to the program unit size),
+    // so that the whole batch takes as few program operations as possible.
+    uint8_t *prog_buf = new uint8_t[prog_buf_size];
+    MBED_ASSERT(prog_buf);
+
+    batch_rec.num_items = num_items;
+    batch_rec.reserved = 0;
+
+    for (int i = -1; i < (int) num_items; i++) {
+        uint16_t key = (i < 0) ? batch_record_key : items[i].key;
+        uint16_t size = (i < 0) ? (uint16_t) sizeof(batch_rec) : items[i].size;
+        const void *buf = (i < 0) ? &batch_rec : items[i].buf;
+
+        calc_record_header(header, key, 0, size, buf);
+        ret = batch_append(area, offset, prog_buf, prog_buf_size, fill, &header, sizeof(header));
+        if (ret != NVSTORE_SUCCESS) {
+            break;
+        }
+        ret = batch_append(area, offset, prog_buf, prog_buf_size, fill, buf, size);
+        if (ret != NVSTORE_SUCCESS) {
+            break;
+        }
+        // Pad to program unit size. As buffer size is a multiple of it, this never overflows.
+        uint32_t pad_size = align_up(fill, _min_prog_size) - fill;
+        memset(prog_buf + fill, blank_flash_val, pad_size);
+        fill += pad_size;
+    }
+
+    if ((ret == NVSTORE_SUCCESS) && fill) {
+        if (flash_write_area(area, offset, fill, prog_buf)) {
+            ret = NVSTORE_WRITE_ERROR;
+        }
+    }
+
+    delete[] prog_buf;
+    return ret;
+}
+
+int NVStore::check_batch(uint8_t area, uint32_t offset, uint32_t end_offset, int &valid)
+{
+    batch_record_data_t batch_rec;
+    uint32_t next_offset;
+    uint16_t actual_size, key, flags;
+    int ret;
+
+    ret = read_record(area, offset, sizeof(batch_rec), &batch_rec,
+                      actual_size, 0, valid, key, flags, next_offset);
+    if ((ret != NVSTORE_SUCCESS) || !valid || (actual_size != sizeof(batch_rec))) {
+        valid = 0;
+        return (ret == NVSTORE_BUFF_TOO_SMALL) ? NVSTORE_SUCCESS : ret;
+    }
+
+    // Batch is only valid if all of its items were completely written
+    for (uint16_t i = 0; i < batch_rec.num_items; i++) {
+        offset = next_offset;
+        if (offset >= end_offset) {
+            valid = 0;
+            return NVSTORE_SUCCESS;
+        }
+        ret = read_record(area, offset, 0, NULL, actual_size, 1, valid, key, flags, next_offset);
+        if ((ret != NVSTORE_SUCCESS) || !valid) {
+            return ret;
+        }
+    }
+
+    return NVSTORE_SUCCESS;
+}
+
 int NVStore::copy_record(uint8_t from_area, uint32_t from_offset, uint32_t to_offset,
                          uint32_t &next_offset)
 {
@@ -507,45 +820,98 @@ int NVStore::copy_record(uint8_t from_area, uint32_t from_offset, uint32_t to_of
     return NVSTORE_SUCCESS;
 }
 
-int NVStore::garbage_collection(uint16_t key, uint16_t flags, uint16_t buf_size, const void *buf)
+int NVStore::gc_start()
 {
-    uint32_t curr_offset, new_area_offset, next_offset;
+    // Standby area must be fully erased before copying records to it
+    int ret = erase_standby_area(1);
+    if (ret != NVSTORE_SUCCESS) {
+        return ret;
+    }
+
+    _gc_offset = align_up(sizeof(nvstore_record_header_t) + sizeof(master_record_data_t), _min_prog_size);
+    _gc_pos = 0;
+    _gc_rescan = 0;
+    _gc_in_progress = 1;
+    return NVSTORE_SUCCESS;
+}
+
+int NVStore::gc_write_record(uint16_t key, uint16_t flags, uint16_t buf_size, const void *buf)
+{
+    uint32_t next_offset;
     int ret;
+
+    if (_gc_offset + align_up(sizeof(nvstore_record_header_t) + buf_size, _min_prog_size) >= _size) {
+        return NVSTORE_FLASH_AREA_TOO_SMALL;
+    }
+
+    ret = write_record(1 - _active_area, _gc_offset, key, flags, buf_size, buf, next_offset);
+    if (ret != NVSTORE_SUCCESS) {
+        return ret;
+    }
+
+    if (flags & delete_item_flag) {
+        index_set(key, 0);
+    } else {
+        index_set(key, _gc_offset | (1 - _active_area) << offs_by_key_area_bit_pos |
+                       (((flags & set_once_flag) != 0) << offs_by_key_set_once_bit_pos));
+    }
+    _gc_offset = next_offset;
+    return NVSTORE_SUCCESS;
+}
+
+int NVStore::gc_copy_records(uint32_t max_records, int &done)
+{
+    uint32_t curr_offset, next_offset, save_flags;
+    uint32_t num_copied = 0;
+    uint16_t key;
     uint8_t curr_area;
+    int ret;
 
-    new_area_offset = align_up(sizeof(nvstore_record_header_t) + sizeof(master_record_data_t), _min_prog_size);
+    done = 0;
 
-    // If GC is triggered by a set item request, we need to first write that item in the new location,
-    // otherwise we may either write it twice (if already included), or lose it in case we decide
-    // to skip it at garbage collection phase (and the system crashes).
-    if ((key != no_key) && !(flags & delete_item_flag)) {
-        ret = write_record(1 - _active_area, new_area_offset, key, 0, buf_size, buf, next_offset);
-        if (ret != NVSTORE_SUCCESS) {
-            return ret;
+    // Iterate on all keys, and copy the ones residing in the active area (meaning that they
+    // weren't copied yet, or were set again since) to the other area.
+    while (num_copied < max_records) {
+        if (_gc_pos >= index_positions()) {
+            // Keys set during this pass may have been skipped - rescan in this case
+            if (!_gc_rescan) {
+                done = 1;
+                break;
+            }
+            _gc_rescan = 0;
+            _gc_pos = 0;
         }
-        _offset_by_key[key] = new_area_offset | (1 - _active_area) << offs_by_key_area_bit_pos |
-                                (((flags & set_once_flag) != 0) << offs_by_key_set_once_bit_pos);
-        new_area_offset = next_offset;
-    }
 
-    // Now iterate on all types, and copy the ones who have valid offsets (meaning that they exist)
-    // to the other area.
-    for (key = 0; key < _max_keys; key++) {
-        curr_offset = _offset_by_key[key];
-        uint16_t save_flags = curr_offset & offs_by_key_area_mask;
+        if (!index_key_at(_gc_pos, key)) {
+            _gc_pos++;
+            continue;
+        }
+        curr_offset = index_get(key);
+        save_flags = curr_offset & offs_by_key_set_once_mask;
         curr_area = (uint8_t)(curr_offset >> offs_by_key_area_bit_pos) & 1;
         curr_offset &= ~offs_by_key_flag_mask;
-        if ((!curr_offset) || (curr_area != _active_area)) {
+        if (curr_area != _active_area) {
+            _gc_pos++;
             continue;
         }
-        ret = copy_record(curr_area, curr_offset, new_area_offset, next_offset);
+        ret = copy_record(curr_area, curr_offset, _gc_offset, next_offset);
         if (ret != NVSTORE_SUCCESS) {
             return ret;
         }
-        _offset_by_key[key] = new_area_offset | (1 - curr_area) << offs_by_key_area_bit_pos | save_flags;
-        new_area_offset = next_offset;
+        index_set(key, _gc_offset | (1 - curr_area) << offs_by_key_area_bit_pos | save_flags);
+        _gc_offset = next_offset;
+        _gc_pos++;
+        num_copied++;
     }
 
+    return NVSTORE_SUCCESS;
+}
+
+int NVStore::gc_finish()
+{
+    uint32_t next_offset;
+    int ret;
+
     // Now write master record, with version incremented by 1.
     _active_area_version++;
     ret = write_master_record(1 - _active_area, _active_area_version, next_offset);
@@ -553,19 +919,150 @@ int NVStore::garbage_collection(uint16_t key, uint16_t flags, uint16_t buf_size,
         return ret;
     }
 
-    _free_space_offset = new_area_offset;
+    _free_space_offset = _gc_offset;
+    _gc_floor_offset = _gc_offset;
+    _gc_in_progress = 0;
+#if NVSTORE_STATS_ENABLED
+    _stats.gc_count++;
+#endif
 
     // Only now we can switch to the new active area
     _active_area = 1 - _active_area;
 
-    // The older area doesn't concern us now. Erase it now.
-    if (flash_erase_area(1 - _active_area)) {
-        return NVSTORE_WRITE_ERROR;
+    // The older area doesn't concern us now. In incremental mode, it is erased
+    // gradually by the following steps. Otherwise, erase it now.
+    _standby_erase_offset = 0;
+    if (!_gc_step_records) {
+        return erase_standby_area(1);
+    }
+
+    return NVSTORE_SUCCESS;
+}
+
+int NVStore::erase_standby_area(int all)
+{
+    uint8_t area = 1 - _active_area;
+    uint32_t sector_size;
+
+    while (_standby_erase_offset < _flash_area_params[area].size) {
+        sector_size = _flash->get_sector_size(_flash_area_params[area].address + _standby_erase_offset);
+        if (flash_erase_sectors(area, _standby_erase_offset, sector_size)) {
+            return NVSTORE_WRITE_ERROR;
+        }
+        _standby_erase_offset += sector_size;
+        if (!all) {
+            break;
+        }
+    }
+
+    return NVSTORE_SUCCESS;
+}
+
+int NVStore::gc_step_locked()
+{
+    int ret, done;
+
+    if (!_gc_in_progress) {
+        // Erase the standby area, one sector per step, before it is needed
+        if (_standby_erase_offset < _flash_area_params[1 - _active_area].size) {
+            return erase_standby_area(0);
+        }
+
+        // Start when the space written since the last compaction crosses the threshold
+        // of the space left by it. This avoids endless compactions of a nearly full area.
+        if ((_free_space_offset - _gc_floor_offset) * 100 <
+            (_size - _gc_floor_offset) * (uint32_t) NVSTORE_GC_THRESHOLD) {
+            return NVSTORE_SUCCESS;
+        }
+
+        ret = gc_start();
+        if (ret != NVSTORE_SUCCESS) {
+            return ret;
+        }
+    }
+
+    ret = gc_copy_records(_gc_step_records, done);
+    if ((ret != NVSTORE_SUCCESS) || !done) {
+        return ret;
     }
 
+    return gc_finish();
+}
+
+int NVStore::garbage_collection(uint16_t key, uint16_t flags, uint16_t buf_size, const void *buf)
+{
+    int ret, done;
+    int in_progress = _gc_in_progress;
+
+    if (!in_progress) {
+        ret = gc_start();
+        if (ret != NVSTORE_SUCCESS) {
+            return ret;
+        }
+    }
+
+    // If GC is triggered by a set item request, we need to first write that item in the new location,
+    // otherwise we may either write it twice (if already included), or lose it in case we decide
+    // to skip it at garbage collection phase (and the system crashes).
+    // A deleted item is simply not copied, unless it was already copied by an incremental step.
+    if (key != no_key) {
+        if (!(flags & delete_item_flag) || in_progress) {
+            ret = gc_write_record(key, flags, buf_size, buf);
+            if (ret != NVSTORE_SUCCESS) {
+                return ret;
+            }
+        } else {
+            index_set(key, 0);
+        }
+    }
+
+    // Copy all remaining records
+    ret = gc_copy_records(0xFFFFFFFF, done);
+    if (ret != NVSTORE_SUCCESS) {
+        return ret;
+    }
+
+    return gc_finish();
+}
+
+int NVStore::gc_step()
+{
+    int ret;
+
+    if (!_init_done) {
+        ret = init();
+        if (ret != NVSTORE_SUCCESS) {
+            return ret;
+        }
+    }
+
+    _mutex->lock();
+    ret = NVSTORE_SUCCESS;
+    if (_gc_step_records) {
+        ret = gc_step_locked();
+    }
+    _mutex->unlock();
     return ret;
 }
 
+void NVStore::set_gc_step_records(uint32_t num_records)
+{
+    // A garbage collection in progress is completed by the following steps or, with no steps,
+    // by the next garbage collection triggered by a full area.
+    if (!_init_done) {
+        _gc_step_records = num_records;
+        return;
+    }
+
+    _mutex->lock();
+    _gc_step_records = num_records;
+    _mutex->unlock();
+}
+
+bool NVStore::gc_in_progress()
+{
+    return _gc_in_progress != 0;
+}
 
 int NVStore::do_get(uint16_t key, uint16_t buf_size, void *buf, uint16_t &actual_size,
                     int validate_only)
@@ -596,7 +1093,7 @@ int NVStore::do_get(uint16_t key, uint16_t buf_size, void *buf, uint16_t &actual
     }
 
     _mutex->lock();
-    record_offset = _offset_by_key[key];
+    record_offset = index_get(key);
 
     if (!record_offset) {
         _mutex->unlock();
@@ -630,8 +1127,6 @@ int NVStore::get_item_size(uint16_t key, uint16_t &actual_size)
 int NVStore::do_set(uint16_t &key, uint16_t buf_size, const void *buf, uint16_t flags)
 {
     int ret = NVSTORE_SUCCESS;
-    uint32_t record_offset, record_size, new_free_space;
-    uint32_t next_offset;
 
     if (!_init_done) {
         ret = init();
@@ -652,21 +1147,42 @@ int NVStore::do_set(uint16_t &key, uint16_t buf_size, const void *buf, uint16_t
         buf_size = 0;
     }
 
-    if ((flags & delete_item_flag) && !_offset_by_key[key]) {
+    // Index may be reallocated by concurrent sets, so only access it under the mutex
+    _mutex->lock();
+
+#if NVSTORE_STATS_ENABLED
+    uint32_t start_time = us_ticker_read();
+#endif
+
+    ret = do_set_locked(key, buf_size, buf, flags);
+
+#if NVSTORE_STATS_ENABLED
+    uint32_t latency = us_ticker_read() - start_time;
+    _stats.set_count++;
+    _stats.max_set_latency_us = std::max(_stats.max_set_latency_us, latency);
+#endif
+
+    _mutex->unlock();
+    return ret;
+}
+
+int NVStore::do_set_locked(uint16_t &key, uint16_t buf_size, const void *buf, uint16_t flags)
+{
+    int ret = NVSTORE_SUCCESS;
+    uint32_t record_offset, record_size, new_free_space;
+    uint32_t next_offset;
+
+    if ((flags & delete_item_flag) && !index_get(key)) {
         return NVSTORE_NOT_FOUND;
     }
 
-    if ((key != no_key) && (_offset_by_key[key] & offs_by_key_set_once_mask)) {
+    if ((key != no_key) && (index_get(key) & offs_by_key_set_once_mask)) {
         return NVSTORE_ALREADY_EXISTS;
     }
 
-    record_size = align_up(sizeof(nvstore_record_header_t) + buf_size, _min_prog_size);
-
-    _mutex->lock();
-
     if (key == no_key) {
         for (key = NVSTORE_NUM_PREDEFINED_KEYS; key < _max_keys; key++) {
-            if (!_offset_by_key[key]) {
+            if (!index_get(key)) {
                 break;
             }
         }
@@ -675,32 +1191,47 @@ int NVStore::do_set(uint16_t &key, uint16_t buf_size, const void *buf, uint16_t
         }
     }
 
+    record_size = align_up(sizeof(nvstore_record_header_t) + buf_size, _min_prog_size);
+
     new_free_space = core_util_atomic_incr_u32(&_free_space_offset, record_size);
     record_offset = new_free_space - record_size;
 
-    // If we cross the area limit, we need to invoke GC.
+    // If we cross the area limit, we need to invoke GC (or complete an incremental one).
     if (new_free_space >= _size) {
-        ret = garbage_collection(key, flags, buf_size, buf);
-        _mutex->unlock();
-        return ret;
+        return garbage_collection(key, flags, buf_size, buf);
     }
 
     // Now write the record
     ret = write_record(_active_area, record_offset, key, flags, buf_size, buf, next_offset);
     if (ret != NVSTORE_SUCCESS) {
-        _mutex->unlock();
         return ret;
     }
 
-    // Update _offset_by_key. High bit indicates area.
+    if (_gc_in_progress) {
+        // A deleted item may have already been copied by the incremental GC, so delete it there as well.
+        // A set item will be copied again, as it is now in the active area.
+        if (flags & delete_item_flag) {
+            ret = gc_write_record(key, flags, 0, NULL);
+            if (ret != NVSTORE_SUCCESS) {
+                return ret;
+            }
+        }
+        _gc_rescan = 1;
+    }
+
+    // Update key index. High bit indicates area.
     if (flags & delete_item_flag) {
-        _offset_by_key[key] = 0;
+        index_set(key, 0);
     } else {
-        _offset_by_key[key] = record_offset | (_active_area << offs_by_key_area_bit_pos) |
-                              (((flags & set_once_flag) != 0) << offs_by_key_set_once_bit_pos);
+        index_set(key, record_offset | (_active_area << offs_by_key_area_bit_pos) |
+                       (((flags & set_once_flag) != 0) << offs_by_key_set_once_bit_pos));
     }
 
-    _mutex->unlock();
+    if (_gc_step_records) {
+        // The item itself is already written. A failing step leaves the GC in progress,
+        // to be retried by the next steps (or completed when the area is full).
+        gc_step_locked();
+    }
 
     return NVSTORE_SUCCESS;
 }
@@ -726,6 +1257,88 @@ int NVStore::remove(uint16_t key)
     return do_set(key, 0, NULL, delete_item_flag);
 }
 
+int NVStore::set_batch(const nvstore_batch_item_t *items, uint16_t num_items)
+{
+    int ret = NVSTORE_SUCCESS;
+    uint32_t record_offset, batch_size;
+    uint16_t i;
+
+    if (!_init_done) {
+        ret = init();
+        if (ret != NVSTORE_SUCCESS) {
+            return ret;
+        }
+    }
+
+    if (!items || !num_items) {
+        return NVSTORE_BAD_VALUE;
+    }
+
+    batch_size = align_up(sizeof(nvstore_record_header_t) + sizeof(batch_record_data_t), _min_prog_size);
+    for (i = 0; i < num_items; i++) {
+        if ((items[i].key >= _max_keys) || (items[i].size && !items[i].buf)) {
+            return NVSTORE_BAD_VALUE;
+        }
+        batch_size += align_up(sizeof(nvstore_record_header_t) + items[i].size, _min_prog_size);
+    }
+
+    _mutex->lock();
+
+#if NVSTORE_STATS_ENABLED
+    uint32_t start_time = us_ticker_read();
+#endif
+
+    for (i = 0; i < num_items; i++) {
+        if (index_get(items[i].key) & offs_by_key_set_once_mask) {
+            _mutex->unlock();
+            return NVSTORE_ALREADY_EXISTS;
+        }
+    }
+
+    // Batch must be written as a whole to the active area. Compact it first if it doesn't fit.
+    if (_free_space_offset + batch_size >= _size) {
+        ret = garbage_collection(no_key, 0, 0, NULL);
+        if ((ret == NVSTORE_SUCCESS) && (_free_space_offset + batch_size >= _size)) {
+            ret = NVSTORE_FLASH_AREA_TOO_SMALL;
+        }
+        if (ret != NVSTORE_SUCCESS) {
+            _mutex->unlock();
+            return ret;
+        }
+    }
+
+    record_offset = core_util_atomic_incr_u32(&_free_space_offset, batch_size) - batch_size;
+
+    ret = write_batch(_active_area, record_offset, items, num_items);
+    if (ret != NVSTORE_SUCCESS) {
+        _mutex->unlock();
+        return ret;
+    }
+
+    // Batch is now committed (valid as a whole) - update key index.
+    record_offset += align_up(sizeof(nvstore_record_header_t) + sizeof(batch_record_data_t), _min_prog_size);
+    for (i = 0; i < num_items; i++) {
+        index_set(items[i].key, record_offset | (_active_area << offs_by_key_area_bit_pos));
+        record_offset += align_up(sizeof(nvstore_record_header_t) + items[i].size, _min_prog_size);
+    }
+
+    if (_gc_in_progress) {
+        _gc_rescan = 1;
+    }
+    if (_gc_step_records) {
+        gc_step_locked();
+    }
+
+#if NVSTORE_STATS_ENABLED
+    uint32_t latency = us_ticker_read() - start_time;
+    _stats.set_count++;
+    _stats.max_set_latency_us = std::max(_stats.max_set_latency_us, latency);
+#endif
+
+    _mutex->unlock();
+    return NVSTORE_SUCCESS;
+}
+
 int NVStore::init()
 {
     area_state_e area_state[NVSTORE_NUM_AREAS];
@@ -755,12 +1368,7 @@ int NVStore::init()
         return NVSTORE_SUCCESS;
     }
 
-    _offset_by_key = new uint32_t[_max_keys];
-    MBED_ASSERT(_offset_by_key);
-
-    for (key = 0; key < _max_keys; key++) {
-        _offset_by_key[key] = 0;
-    }
+    index_init();
 
     _mutex = new PlatformMutex;
     MBED_ASSERT(_mutex);
@@ -827,11 +1435,16 @@ int NVStore::init()
         _active_area_version = versions[area];
     }
 
+    // Nonactive area is either empty or erased below, and no GC is in progress.
+    _gc_in_progress = 0;
+
     // In case we have two empty areas, arbitrarily assign 0 to the active one.
     if ((area_state[0] == NVSTORE_AREA_STATE_EMPTY) && (area_state[1] == NVSTORE_AREA_STATE_EMPTY)) {
         _active_area = 0;
         ret = write_master_record(_active_area, 1, _free_space_offset);
         MBED_ASSERT(ret == NVSTORE_SUCCESS);
+        _gc_floor_offset = _free_space_offset;
+        _standby_erase_offset = _flash_area_params[1 - _active_area].size;
         _init_done = 1;
         return NVSTORE_SUCCESS;
     }
@@ -849,6 +1462,9 @@ int NVStore::init()
         MBED_ASSERT(!os_ret);
     }
 
+    _gc_floor_offset = _free_space_offset;
+    _standby_erase_offset = _flash_area_params[1 - _active_area].size;
+
     // Traverse area until reaching the empty space at the end or until reaching a faulty record
     while (_free_space_offset < free_space_offset_of_area[_active_area]) {
         ret = read_record(_active_area, _free_space_offset, 0, NULL,
@@ -858,15 +1474,24 @@ int NVStore::init()
 
         // In case we have a faulty record, this probably means that the system crashed when written.
         // Perform a garbage collection, to make the the other area valid.
+        if (valid && (key == batch_record_key)) {
+            // Batch items follow (and are handled as regular records), unless batch is incomplete.
+            ret = check_batch(_active_area, _free_space_offset, free_space_offset_of_area[_active_area], valid);
+            MBED_ASSERT(ret == NVSTORE_SUCCESS);
+            if (valid) {
+                _free_space_offset = next_offset;
+                continue;
+            }
+        }
         if (!valid) {
             ret = garbage_collection(no_key, 0, 0, NULL);
             break;
         }
         if (flags & delete_item_flag) {
-            _offset_by_key[key] = 0;
+            index_set(key, 0);
         } else {
-            _offset_by_key[key] = _free_space_offset | (_active_area << offs_by_key_area_bit_pos) |
-                                  (((flags & set_once_flag) != 0) << offs_by_key_set_once_bit_pos);
+            index_set(key, _free_space_offset | (_active_area << offs_by_key_area_bit_pos) |
+                           (((flags & set_once_flag) != 0) << offs_by_key_set_once_bit_pos));
         }
         _free_space_offset = next_offset;
     }
@@ -881,7 +1506,7 @@ int NVStore::deinit()
         _flash->deinit();
         delete _flash;
         delete _mutex;
-        delete[] _offset_by_key;
+        index_deinit();
         if (_page_buf) {
             delete[] _page_buf;
             _page_buf = 0;
@@ -917,6 +1542,22 @@ int NVStore::reset()
     return init();
 }
 
+void NVStore::get_stats(nvstore_stats_t &stats)
+{
+#if NVSTORE_STATS_ENABLED
+    stats = _stats;
+#else
+    memset(&stats, 0, sizeof(stats));
+#endif
+}
+
+void NVStore::reset_stats()
+{
+#if NVSTORE_STATS_ENABLED
+    memset(&_stats, 0, sizeof(_stats));
+#endif
+}
+
 int NVStore::get_area_params(uint8_t area, uint32_t &address, size_t &size)
 {
     if (area >= NVSTORE_NUM_AREAS) {
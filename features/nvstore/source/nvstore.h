@@ -53,10 +53,46 @@ typedef enum {
     NVSTORE_NUM_PREDEFINED_KEYS
 } nvstore_predefined_keys_e;
 
+typedef struct {
+    uint16_t key;                   /**< Item key */
+    uint16_t size;                  /**< Item size in bytes */
+    const void *buf;                /**< Item data */
+} nvstore_batch_item_t;
+
+typedef struct {
+    uint32_t set_count;             /**< Number of set operations (including set_once, remove and set_batch) */
+    uint32_t max_set_latency_us;    /**< Worst case set latency (microseconds), excluding mutex wait */
+    uint32_t gc_count;              /**< Number of completed garbage collections */
+    uint32_t program_count;         /**< Number of flash program operations */
+} nvstore_stats_t;
+
 #ifndef NVSTORE_MAX_KEYS
 #define NVSTORE_MAX_KEYS ((uint16_t)NVSTORE_NUM_PREDEFINED_KEYS)
 #endif
 
+// Number of records copied to the other area by each incremental garbage collection
+// step (0 disables incremental garbage collection)
+#ifndef NVSTORE_GC_STEP_RECORDS
+#define NVSTORE_GC_STEP_RECORDS 0
+#endif
+
+// Percentage of the space left by the last garbage collection, which, once written,
+// starts an incremental garbage collection
+#ifndef NVSTORE_GC_THRESHOLD
+#define NVSTORE_GC_THRESHOLD 50
+#endif
+
+// Collect set latency statistics
+#ifndef NVSTORE_STATS_ENABLED
+#define NVSTORE_STATS_ENABLED 0
+#endif
+
+// Use a compact (hashed) key index, scaling with the number of live keys
+// rather than with the maximal number of keys
+#ifndef NVSTORE_COMPACT_INDEX
+#define NVSTORE_COMPACT_INDEX 0
+#endif
+
 // defines 2 areas - active and nonactive, not configurable
 #define NVSTORE_NUM_AREAS        2
 
@@ -96,6 +132,7 @@ public:
 
     /**
      * @brief Set number of keys.
+     *        Reinitializes the module, unless the compact key index is used.
      *
      * @returns None.
      */
@@ -194,6 +231,24 @@ public:
     int set_once(uint16_t key, uint16_t buf_size, const void *buf);
 
 
+    /**
+     * @brief Programs several items of data on Flash, atomically: after a power failure,
+     *        either all items or none of them are set. Items are packed in as few
+     *        flash program operations as possible.
+     *
+     * @param[in]  items                Items (key, size and data of each).
+     * @param[in]  num_items            Number of items.
+     *
+     * @returns NVSTORE_SUCCESS           Values were successfully written on Flash.
+     *          NVSTORE_WRITE_ERROR       Physical error writing data.
+     *          NVSTORE_BAD_VALUE         Bad value in any of the parameters.
+     *          NVSTORE_FLASH_AREA_TOO_SMALL
+     *                                    Not enough space in Flash area.
+     *          NVSTORE_ALREADY_EXISTS    Item set with write once API already exists.
+     *
+     */
+    int set_batch(const nvstore_batch_item_t *items, uint16_t num_items);
+
     /**
      * @brief Remove an item from flash.
      *
@@ -208,6 +263,48 @@ public:
      */
     int remove(uint16_t key);
 
+    /**
+     * @brief Perform one step of incremental garbage collection: copy up to the configured number
+     *        of records to the nonactive area, or erase one sector of it. Steps are also taken by each set,
+     *        but calling this from a background context (like an EventQueue callback) keeps set
+     *        latency lower. Does nothing when incremental garbage collection is disabled.
+     *
+     * @returns NVSTORE_SUCCESS       Step completed successfully (or nothing to do).
+     *          NVSTORE_READ_ERROR    Physical error reading data.
+     *          NVSTORE_WRITE_ERROR   Physical error writing data.
+     *          NVSTORE_FLASH_AREA_TOO_SMALL
+     *                                Not enough space in Flash area.
+     */
+    int gc_step();
+
+    /**
+     * @brief Set number of records copied by each incremental garbage collection step
+     *        (0 - garbage collection is done at once). Defaults to NVSTORE_GC_STEP_RECORDS.
+     *
+     * @returns None.
+     */
+    void set_gc_step_records(uint32_t num_records);
+
+    /**
+     * @brief Check whether an incremental garbage collection has copied some, but not all,
+     *        of the records to the nonactive area.
+     *
+     * @returns true if a garbage collection is in progress, false otherwise.
+     */
+    bool gc_in_progress();
+
+    /**
+     * @brief Get NVStore statistics (all zero unless NVSTORE_STATS_ENABLED is set).
+     *
+     * @param[out] stats                  Statistics.
+     */
+    void get_stats(nvstore_stats_t &stats);
+
+    /**
+     * @brief Reset NVStore statistics.
+     */
+    void reset_stats();
+
     /**
      * @brief Initializes NVStore component.
      *
@@ -273,16 +370,81 @@ private:
     uint32_t _free_space_offset;
     size_t _size;
     PlatformMutex *_mutex;
+#if NVSTORE_COMPACT_INDEX
+    typedef struct {
+        uint16_t key;
+        uint32_t offset;
+    } nvstore_index_entry_t;
+
+    nvstore_index_entry_t *_index;
+    uint32_t _index_size;
+    uint32_t _index_count;
+#else
     uint32_t *_offset_by_key;
+#endif
     nvstore_area_data_t _flash_area_params[NVSTORE_NUM_AREAS];
     static nvstore_area_data_t initial_area_params[NVSTORE_NUM_AREAS];
     mbed::FlashIAP *_flash;
     uint32_t _min_prog_size;
     uint8_t *_page_buf;
+    int _gc_in_progress;
+    int _gc_rescan;
+    uint32_t _gc_pos;
+    uint32_t _gc_offset;
+    uint32_t _gc_floor_offset;
+    uint32_t _standby_erase_offset;
+    uint32_t _gc_step_records;
+#if NVSTORE_STATS_ENABLED
+    nvstore_stats_t _stats;
+#endif
 
     // Private constructor, as class is a singleton
     NVStore();
 
+    /**
+     * @brief Allocate the key index (empty).
+     */
+    void index_init();
+
+    /**
+     * @brief Free the key index.
+     */
+    void index_deinit();
+
+    /**
+     * @brief Get the offset (including area and flag bits) of a key.
+     *
+     * @param[in]  key                    Key.
+     *
+     * @returns Offset of key, 0 if key doesn't exist.
+     */
+    uint32_t index_get(uint16_t key) const;
+
+    /**
+     * @brief Set the offset (including area and flag bits) of a key.
+     *
+     * @param[in]  key                    Key.
+     * @param[in]  offset                 Offset of key, 0 removes the key.
+     */
+    void index_set(uint16_t key, uint32_t offset);
+
+    /**
+     * @brief Return the number of index positions, for iterating with index_key_at.
+     *
+     * @returns Number of index positions.
+     */
+    uint32_t index_positions() const;
+
+    /**
+     * @brief Get the key stored at a given index position.
+     *
+     * @param[in]  pos                    Index position.
+     * @param[out] key                    Key at this position.
+     *
+     * @returns 1 if position holds an existing key, 0 otherwise.
+     */
+    int index_key_at(uint32_t pos, uint16_t &key) const;
+
     /**
      * @brief Read a block from an area.
      *
@@ -316,6 +478,17 @@ private:
      */
     int flash_erase_area(uint8_t area);
 
+    /**
+     * @brief Erase sectors of an area.
+     *
+     * @param[in]  area                   Area.
+     * @param[in]  offset                 Offset in area (sector aligned).
+     * @param[in]  size                   Number of bytes to erase (sector aligned).
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int flash_erase_sectors(uint8_t area, uint32_t offset, uint32_t size);
+
     /**
      * @brief Calculate addresses and sizes of areas (in case no user configuration is given),
      *        or validate user configuration (if given).
@@ -379,6 +552,47 @@ private:
      */
     int write_master_record(uint8_t area, uint16_t version, uint32_t &next_offset);
 
+    /**
+     * @brief Append data to a batch program buffer, programming it when full.
+     *
+     * @param[in]    area                 Area.
+     * @param[inout] offset               Offset in area of program buffer.
+     * @param[in]    prog_buf             Program buffer.
+     * @param[in]    prog_buf_size        Program buffer size (bytes).
+     * @param[inout] fill                 Number of bytes in program buffer.
+     * @param[in]    data                 Data.
+     * @param[in]    size                 Data size (bytes).
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int batch_append(uint8_t area, uint32_t &offset, uint8_t *prog_buf, uint32_t prog_buf_size,
+                     uint32_t &fill, const void *data, uint32_t size);
+
+    /**
+     * @brief Write a batch record, followed by the records of all batch items.
+     *
+     * @param[in]  area                   Area.
+     * @param[in]  offset                 Offset of batch record in area.
+     * @param[in]  items                  Batch items.
+     * @param[in]  num_items              Number of batch items.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int write_batch(uint8_t area, uint32_t offset, const nvstore_batch_item_t *items,
+                    uint16_t num_items);
+
+    /**
+     * @brief Check that all items of a batch were completely written.
+     *
+     * @param[in]  area                   Area.
+     * @param[in]  offset                 Offset of batch record in area.
+     * @param[in]  end_offset             Offset of empty space in area.
+     * @param[out] valid                  Is the batch valid.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int check_batch(uint8_t area, uint32_t offset, uint32_t end_offset, int &valid);
+
     /**
      * @brief Copy a record from one area to the other one.
      *
@@ -392,8 +606,61 @@ private:
     int copy_record(uint8_t from_area, uint32_t from_offset, uint32_t to_offset,
                     uint32_t &next_offset);
 
+    /**
+     * @brief Start a garbage collection (erasing what's left of the nonactive area).
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int gc_start();
+
+    /**
+     * @brief Write a record to the nonactive area during garbage collection, updating the key index.
+     *
+     * @param[in]  key                    Record key.
+     * @param[in]  flags                  Record flags.
+     * @param[in]  buf_size               Data size (bytes).
+     * @param[in]  buf                    Data buffer.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int gc_write_record(uint16_t key, uint16_t flags, uint16_t buf_size, const void *buf);
+
+    /**
+     * @brief Copy records from the active area to the nonactive one, continuing the current pass.
+     *
+     * @param[in]  max_records            Maximal number of records to copy.
+     * @param[out] done                   Set when all records were copied.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int gc_copy_records(uint32_t max_records, int &done);
+
+    /**
+     * @brief Complete garbage collection: write master record and switch areas.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int gc_finish();
+
+    /**
+     * @brief Erase the nonactive area, continuing from where the previous erase stopped.
+     *
+     * @param[in]  all                    Erase all remaining sectors (otherwise only one).
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int erase_standby_area(int all);
+
+    /**
+     * @brief Single incremental garbage collection step (mutex held by caller).
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int gc_step_locked();
+
     /**
      * @brief Garbage collection (compact all records from active area to nonactive ones).
+     *        Completes an incremental garbage collection if one is in progress.
      *        All parameters belong to a record that needs to be written before the process.
      *
      * @param[in]  key                    Record key.
@@ -431,6 +698,18 @@ private:
      */
     int do_set(uint16_t &key, uint16_t buf_size, const void *buf, uint16_t flags);
 
+    /**
+     * @brief Set logics, once parameters are validated and mutex is held.
+     *
+     * @param[out] key                    key (both input and output).
+     * @param[in]  buf_size               Buffer size (bytes).
+     * @param[in]  buf                    Input Buffer.
+     * @param[in]  flags                  Record flags.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int do_set_locked(uint16_t &key, uint16_t buf_size, const void *buf, uint16_t flags);
+
 };
 /** @}*/
 
@@ -56,6 +56,8 @@ static void initialize(const ticker_data_t *ticker)
     ticker->queue->tick_last_read = ticker->interface->read();
     ticker->queue->tick_remainder = 0;
     ticker->queue->frequency = frequency;
+    // 2^64 / frequency, saturated for 1 Hz
+    ticker->queue->frequency_reciprocal = frequency > 1 ? UINT64_MAX / frequency : UINT64_MAX;
     ticker->queue->bitmask = ((uint64_t)1 << bits) - 1;
     ticker->queue->max_delta = max_delta;
     ticker->queue->max_delta_us = max_delta_us;
@@ -74,6 +76,49 @@ static void set_handler(const ticker_data_t *const ticker, ticker_event_handler
     ticker->queue->event_handler = handler;
 }
 
+/*
+ * Return the upper 64 bits of the 128 bit product of a and b.
+ */
+static uint64_t mul_high(uint64_t a, uint64_t b)
+{
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t hi_hi = a_hi * b_hi;
+
+    uint64_t middle = (lo_lo >> 32) + (uint32_t)hi_lo + (uint32_t)lo_hi;
+    return hi_hi + (hi_lo >> 32) + (lo_hi >> 32) + (middle >> 32);
+}
+
+/*
+ * Divide x by divisor using reciprocal, which is 2^64 / divisor rounded down.
+ *
+ * Targets without a hardware divider do 64 bit divisions in software, which
+ * is much slower than the multiplications used here. The quotient estimated
+ * from the reciprocal is at most 2 too small for x < 2^63, and is corrected
+ * with the remainder so the result is exact.
+ *
+ * @param remainder: Set to x % divisor.
+ */
+static uint64_t divide(uint64_t x, uint64_t reciprocal, uint32_t divisor, uint64_t *remainder)
+{
+    uint64_t quotient = mul_high(x, reciprocal);
+    uint64_t rest = x - quotient * divisor;
+    while (rest >= divisor) {
+        quotient++;
+        rest -= divisor;
+    }
+
+    *remainder = rest;
+    return quotient;
+}
+
+/* 2^64 / 1000000 rounded down */
+#define US_PER_SECOND_RECIPROCAL 18446744073709ULL
+
 /*
  * Convert a 32 bit timestamp into a 64 bit timestamp.
  *
@@ -141,10 +186,11 @@ static void update_present_time(const ticker_data_t *const ticker)
         // General case
 
         uint64_t us_x_ticks = elapsed_ticks * 1000000;
-        elapsed_us = us_x_ticks / queue->frequency;
+        uint64_t remainder;
+        elapsed_us = divide(us_x_ticks, queue->frequency_reciprocal, queue->frequency, &remainder);
 
         // Update remainder
-        queue->tick_remainder += us_x_ticks - elapsed_us * queue->frequency;
+        queue->tick_remainder += remainder;
         if (queue->tick_remainder >= queue->frequency) {
             elapsed_us += 1;
             queue->tick_remainder -= queue->frequency;
@@ -184,7 +230,8 @@ static timestamp_t compute_tick(const ticker_data_t *const ticker, us_timestamp_
         } else {
             // General case
 
-            delta = delta_us * queue->frequency / 1000000;
+            uint64_t remainder;
+            delta = divide(delta_us * queue->frequency, US_PER_SECOND_RECIPROCAL, 1000000, &remainder);
             if (delta > ticker->queue->max_delta) {
                 delta = ticker->queue->max_delta;
             }
@@ -205,6 +252,164 @@ int _ticker_match_interval_passed(timestamp_t prev_tick, timestamp_t cur_tick, t
     }
 }
 
+#if MBED_CONF_PLATFORM_TICKER_QUEUE_HEAP
+/*
+ * The queue is a pairing heap ordered by timestamp, its root is the head of
+ * the queue. Inserting is constant time and removing an event, including the
+ * head, takes O(log n) amortized time, so the time spent in critical sections
+ * doesn't grow linearly with the number of events like the sorted list does.
+ * Events with the same timestamp are not guaranteed to run in the order they
+ * were inserted.
+ *
+ * The children of a node are a list linked by next, the first child's prev
+ * points to the parent, the others' to the previous sibling. Only events in
+ * the heap other than the root have a prev.
+ */
+
+/**
+ * Make the root with the later timestamp the first child of the other one.
+ */
+static ticker_event_t *heap_link(ticker_event_t *a, ticker_event_t *b)
+{
+    if (b->timestamp < a->timestamp) {
+        ticker_event_t *tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    b->prev = a;
+    b->next = a->child;
+    if (a->child) {
+        a->child->prev = b;
+    }
+    a->child = b;
+    return a;
+}
+
+/**
+ * Merge a list of siblings into a single heap, linking them in pairs from
+ * the left and then the pairs from the right.
+ */
+static ticker_event_t *heap_merge_siblings(ticker_event_t *first)
+{
+    ticker_event_t *pairs = NULL;
+    while (first) {
+        ticker_event_t *a = first;
+        ticker_event_t *b = a->next;
+        if (b) {
+            first = b->next;
+            a = heap_link(a, b);
+        } else {
+            first = NULL;
+        }
+        // Stack the pairs in reverse order through next
+        a->next = pairs;
+        pairs = a;
+    }
+
+    if (pairs == NULL) {
+        return NULL;
+    }
+
+    ticker_event_t *root = pairs;
+    pairs = pairs->next;
+    while (pairs) {
+        ticker_event_t *next = pairs->next;
+        root = heap_link(root, pairs);
+        pairs = next;
+    }
+    root->next = NULL;
+    root->prev = NULL;
+    return root;
+}
+
+static void queue_remove(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    if (obj == queue->head) {
+        queue->head = heap_merge_siblings(obj->child);
+    } else if (obj->prev) {
+        // Unlink from the parent or the previous sibling
+        if (obj->prev->child == obj) {
+            obj->prev->child = obj->next;
+        } else {
+            obj->prev->next = obj->next;
+        }
+        if (obj->next) {
+            obj->next->prev = obj->prev;
+        }
+
+        ticker_event_t *children = heap_merge_siblings(obj->child);
+        if (children) {
+            queue->head = heap_link(queue->head, children);
+        }
+    } else {
+        // Not in the queue
+        return;
+    }
+
+    obj->next = NULL;
+    obj->child = NULL;
+    obj->prev = NULL;
+}
+
+static void queue_insert(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    queue_remove(queue, obj);
+
+    if (queue->head) {
+        queue->head = heap_link(queue->head, obj);
+    } else {
+        queue->head = obj;
+    }
+}
+#else
+static void queue_remove(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    // remove this object from the list
+    if (queue->head == obj) {
+        // first in the list, so just drop me
+        queue->head = obj->next;
+    } else {
+        // find the object before me, then drop me
+        ticker_event_t* p = queue->head;
+        while (p != NULL) {
+            if (p->next == obj) {
+                p->next = obj->next;
+                break;
+            }
+            p = p->next;
+        }
+    }
+}
+
+static void queue_insert(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    /* Go through the list until we either reach the end, or find
+       an element this should come before (which is possibly the
+       head). */
+    ticker_event_t *prev = NULL, *p = queue->head;
+    while (p != NULL) {
+        /* check if we come before p */
+        if (obj->timestamp < p->timestamp) {
+            break;
+        }
+        /* go to the next element */
+        prev = p;
+        p = p->next;
+    }
+
+    /* if we're at the end p will be NULL, which is correct */
+    obj->next = p;
+
+    /* if prev is NULL we're at the head */
+    if (prev == NULL) {
+        queue->head = obj;
+    } else {
+        prev->next = obj;
+    }
+}
+#endif
+
 /**
  * Compute the time when the interrupt has to be triggered and schedule it.  
  * 
@@ -284,7 +489,7 @@ void ticker_irq_handler(const ticker_data_t *const ticker)
             // This event was in the past:
             //      point to the following one and execute its handler
             ticker_event_t *p = ticker->queue->head;
-            ticker->queue->head = ticker->queue->head->next;
+            queue_remove(ticker->queue, p);
             if (ticker->queue->event_handler != NULL) {
                 (*ticker->queue->event_handler)(p->id); // NOTE: the handler can set new events
             }
@@ -331,29 +536,7 @@ void ticker_insert_event_us(const ticker_data_t *const ticker, ticker_event_t *o
     obj->timestamp = timestamp;
     obj->id = id;
 
-    /* Go through the list until we either reach the end, or find
-       an element this should come before (which is possibly the
-       head). */
-    ticker_event_t *prev = NULL, *p = ticker->queue->head;
-    while (p != NULL) {
-        /* check if we come before p */
-        if (timestamp < p->timestamp) {
-            break;
-        }
-        /* go to the next element */
-        prev = p;
-        p = p->next;
-    }
-    
-    /* if we're at the end p will be NULL, which is correct */
-    obj->next = p;
-
-    /* if prev is NULL we're at the head */
-    if (prev == NULL) {
-        ticker->queue->head = obj;
-    } else {
-        prev->next = obj;
-    }
+    queue_insert(ticker->queue, obj);
 
     schedule_interrupt(ticker);
 
@@ -365,21 +548,11 @@ void ticker_remove_event(const ticker_data_t *const ticker, ticker_event_t *obj)
 {
     core_util_critical_section_enter();
 
-    // remove this object from the list
     if (ticker->queue->head == obj) {
-        // first in the list, so just drop me
-        ticker->queue->head = obj->next;
+        queue_remove(ticker->queue, obj);
         schedule_interrupt(ticker);
     } else {
-        // find the object before me, then drop me
-        ticker_event_t* p = ticker->queue->head;
-        while (p != NULL) {
-            if (p->next == obj) {
-                p->next = obj->next;
-                break;
-            }
-            p = p->next;
-        }
+        queue_remove(ticker->queue, obj);
     }
 
     core_util_critical_section_exit();
@@ -38,11 +38,19 @@ typedef uint32_t timestamp_t;
 typedef uint64_t us_timestamp_t;
 
 /** Ticker's event structure
+ *
+ * With MBED_CONF_PLATFORM_TICKER_QUEUE_HEAP the events are kept in a pairing
+ * heap rather than a sorted list, the head of the queue is then the root of the
+ * heap and next links the siblings of a node.
  */
 typedef struct ticker_event_s {
     us_timestamp_t         timestamp; /**< Event's timestamp */
     uint32_t               id;        /**< TimerEvent object */
     struct ticker_event_s *next;      /**< Next event in the queue */
+#if MBED_CONF_PLATFORM_TICKER_QUEUE_HEAP
+    struct ticker_event_s *child;     /**< First child in the heap */
+    struct ticker_event_s *prev;      /**< Previous sibling, or parent of a first child */
+#endif
 } ticker_event_t;
 
 typedef void (*ticker_event_handler)(uint32_t id);
@@ -73,6 +81,7 @@ typedef struct {
     ticker_event_handler event_handler; /**< Event handler */
     ticker_event_t *head;               /**< A pointer to head */
     uint32_t frequency;                 /**< Frequency of the timer in Hz */
+    uint64_t frequency_reciprocal;      /**< 2^64 / frequency, to divide by the frequency with multiplications */
     uint32_t bitmask;                   /**< Mask to be applied to time values read */
     uint32_t max_delta;                 /**< Largest delta in ticks that can be used when scheduling */
     uint64_t max_delta_us;              /**< Largest delta in us that can be used when scheduling */
@@ -105,6 +105,63 @@ public:
         return data_popped;
     }
 
+    /** Push a block of data to the buffer
+     *
+     *  Unlike pushing a single element, this doesn't overwrite the buffer when
+     *  it's full, only as many elements as there is space for are pushed.
+     *
+     * @param src Elements to be pushed to the buffer
+     * @param len Number of elements in src
+     * @return Number of elements pushed
+     */
+    CounterType push(const T *src, CounterType len) {
+        CounterType pushed = 0;
+        core_util_critical_section_enter();
+        while (pushed < len && !_full) {
+            // Free space up to the tail or the end of the pool
+            CounterType span = (_head < _tail ? _tail : BufferSize) - _head;
+            if (span > len - pushed) {
+                span = len - pushed;
+            }
+            for (CounterType i = 0; i < span; i++) {
+                _pool[_head + i] = src[pushed + i];
+            }
+            _head = (_head + span) % BufferSize;
+            if (_head == _tail) {
+                _full = true;
+            }
+            pushed += span;
+        }
+        core_util_critical_section_exit();
+        return pushed;
+    }
+
+    /** Pop a block of data from the buffer
+     *
+     * @param dest Buffer to pop the elements into
+     * @param len Maximum number of elements to pop
+     * @return Number of elements popped, 0 if the buffer is empty
+     */
+    CounterType pop(T *dest, CounterType len) {
+        CounterType popped = 0;
+        core_util_critical_section_enter();
+        while (popped < len && !empty()) {
+            // Stored elements up to the head or the end of the pool
+            CounterType span = (_tail < _head ? _head : BufferSize) - _tail;
+            if (span > len - popped) {
+                span = len - popped;
+            }
+            for (CounterType i = 0; i < span; i++) {
+                dest[popped + i] = _pool[_tail + i];
+            }
+            _tail = (_tail + span) % BufferSize;
+            _full = false;
+            popped += span;
+        }
+        core_util_critical_section_exit();
+        return popped;
+    }
+
     /** Check if the buffer is empty
      *
      * @return True if the buffer is empty, false if not
@@ -211,6 +211,18 @@ public:
         return POLLIN | POLLOUT;
     }
 
+    /** Check if the FileHandle wakes up mbed::poll() on events
+     *  FileHandles returning true call mbed::poll_change() whenever the events
+     *  returned by poll() may have changed, so mbed::poll() can block on them
+     *  without scanning them periodically.
+     *
+     * @returns             true if the FileHandle calls mbed::poll_change()
+     */
+    virtual bool wakes_poll() const
+    {
+        return false;
+    }
+
     /** Definition depends upon the subclass implementing FileHandle.
      *  For example, if the FileHandle is of type Stream, writable() could return
      *  true when there is ample buffer space available for write() calls.
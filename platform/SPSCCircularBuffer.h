@@ -0,0 +1,186 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_SPSCCIRCULARBUFFER_H
+#define MBED_SPSCCIRCULARBUFFER_H
+
+#include "platform/mbed_critical.h"
+#include "platform/mbed_assert.h"
+
+namespace mbed {
+
+/** \addtogroup platform */
+/** @{*/
+/**
+ * \ingroup platform_CircularBuffer
+ * @{
+ */
+
+/** Templated lock-free circular buffer for a single producer and a single consumer
+ *
+ *  Like CircularBuffer, but without critical sections: the producer only
+ *  moves the head and the consumer only moves the tail, each publishing its
+ *  side with a memory barrier. Meant for passing data from an interrupt
+ *  handler to a thread or from a thread to an interrupt handler, without
+ *  disabling interrupts.
+ *
+ *  The head and tail count elements pushed and popped and wrap around
+ *  naturally, the pool is indexed by masking them, so BufferSize must be a
+ *  power of two. All of the BufferSize elements can be used.
+ *
+ *  @note Synchronization level: Interrupt safe for one producer (push calls)
+ *        and one consumer (pop and peek calls) at a time. reset may only be
+ *        called when neither is active.
+ *  @note Unlike CircularBuffer, push doesn't overwrite the buffer when it's
+ *        full, since only the consumer moves the tail.
+ */
+template<typename T, uint32_t BufferSize>
+class SPSCCircularBuffer {
+public:
+    SPSCCircularBuffer() : _head(0), _tail(0) {
+        MBED_STATIC_ASSERT(
+            BufferSize > 0 && (BufferSize & (BufferSize - 1)) == 0,
+            "BufferSize must be a power of two"
+        );
+    }
+
+    ~SPSCCircularBuffer() {
+    }
+
+    /** Push the transaction to the buffer
+     *
+     * @param data Data to be pushed to the buffer
+     * @return True if the data was pushed, false if the buffer is full
+     */
+    bool push(const T& data) {
+        return push(&data, 1) == 1;
+    }
+
+    /** Push a block of data to the buffer
+     *
+     *  Only as many elements as there is space for are pushed.
+     *
+     * @param src Elements to be pushed to the buffer
+     * @param len Number of elements in src
+     * @return Number of elements pushed
+     */
+    uint32_t push(const T *src, uint32_t len) {
+        uint32_t head = _head;
+        uint32_t space = BufferSize - (head - _tail);
+        if (len > space) {
+            len = space;
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            _pool[(head + i) & (BufferSize - 1)] = src[i];
+        }
+        // Elements must be stored before the consumer sees the new head
+        core_util_memory_barrier();
+        _head = head + len;
+        return len;
+    }
+
+    /** Pop the transaction from the buffer
+     *
+     * @param data Data to be popped from the buffer
+     * @return True if the buffer is not empty and data contains a transaction, false otherwise
+     */
+    bool pop(T& data) {
+        return pop(&data, 1) == 1;
+    }
+
+    /** Pop a block of data from the buffer
+     *
+     * @param dest Buffer to pop the elements into
+     * @param len Maximum number of elements to pop
+     * @return Number of elements popped, 0 if the buffer is empty
+     */
+    uint32_t pop(T *dest, uint32_t len) {
+        uint32_t tail = _tail;
+        uint32_t stored = _head - tail;
+        if (len > stored) {
+            len = stored;
+        }
+        if (len == 0) {
+            return 0;
+        }
+        // Elements must be loaded after the head that published them
+        core_util_memory_barrier();
+        for (uint32_t i = 0; i < len; i++) {
+            dest[i] = _pool[(tail + i) & (BufferSize - 1)];
+        }
+        // And before the producer sees the space freed
+        core_util_memory_barrier();
+        _tail = tail + len;
+        return len;
+    }
+
+    /** Peek into circular buffer without popping
+     *
+     * @param data Data to be peeked from the buffer
+     * @return True if the buffer is not empty and data contains a transaction, false otherwise
+     */
+    bool peek(T& data) const {
+        uint32_t tail = _tail;
+        if (_head == tail) {
+            return false;
+        }
+        core_util_memory_barrier();
+        data = _pool[tail & (BufferSize - 1)];
+        return true;
+    }
+
+    /** Check if the buffer is empty
+     *
+     * @return True if the buffer is empty, false if not
+     */
+    bool empty() const {
+        return _head == _tail;
+    }
+
+    /** Check if the buffer is full
+     *
+     * @return True if the buffer is full, false if not
+     */
+    bool full() const {
+        return size() == BufferSize;
+    }
+
+    /** Reset the buffer
+     *
+     */
+    void reset() {
+        _tail = _head;
+    }
+
+    /** Get the number of elements currently stored in the circular_buffer */
+    uint32_t size() const {
+        // Read the tail first, the head only grows after it
+        uint32_t tail = _tail;
+        return _head - tail;
+    }
+
+private:
+    T _pool[BufferSize];
+    volatile uint32_t _head;
+    volatile uint32_t _tail;
+};
+
+/**@}*/
+
+/**@}*/
+
+}
+
+#endif
@@ -75,6 +75,11 @@ bool core_util_in_critical_section(void)
     return hal_in_critical_section();
 }
 
+void core_util_memory_barrier(void)
+{
+    __DMB();
+}
+
 void core_util_critical_section_enter(void)
 {
 // FIXME
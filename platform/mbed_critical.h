@@ -89,6 +89,16 @@ void core_util_critical_section_exit(void);
  */
 bool core_util_in_critical_section(void);
 
+/**
+ * Memory barrier
+ *
+ * Memory accesses before the barrier are seen by interrupt handlers and
+ * other cores before those after it. The compiler doesn't move accesses
+ * across it either. Used to publish data without a critical section, for
+ * instance by lock-free single producer, single consumer queues.
+ */
+void core_util_memory_barrier(void);
+
 /**
  * Atomic compare and set. It compares the contents of a memory location to a
  * given value and, only if they are the same, modifies the contents of that
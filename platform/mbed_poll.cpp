@@ -15,9 +15,10 @@
  */
 #include "mbed_poll.h"
 #include "FileHandle.h"
+#include "mbed_critical.h"
 #if MBED_CONF_RTOS_PRESENT
 #include "rtos/Kernel.h"
-#include "rtos/Thread.h"
+#include "rtos/Semaphore.h"
 using namespace rtos;
 #else
 #include "Timer.h"
@@ -26,23 +27,84 @@ using namespace rtos;
 
 namespace mbed {
 
+#if MBED_CONF_RTOS_PRESENT
+/* A thread blocked in poll(), woken by poll_change() on any of its handles */
+struct poll_waiter {
+    poll_waiter(pollfh *fhs, unsigned nfhs) : next(NULL), fhs(fhs), nfhs(nfhs), wakeup(0, 1) {}
+
+    poll_waiter *next;
+    pollfh *fhs;
+    unsigned nfhs;
+    Semaphore wakeup;
+};
+
+static poll_waiter *poll_waiters;
+
+static void poll_wait_start(poll_waiter *waiter)
+{
+    core_util_critical_section_enter();
+    waiter->next = poll_waiters;
+    poll_waiters = waiter;
+    core_util_critical_section_exit();
+}
+
+static void poll_wait_end(poll_waiter *waiter)
+{
+    core_util_critical_section_enter();
+    poll_waiter **p = &poll_waiters;
+    while (*p != waiter) {
+        p = &(*p)->next;
+    }
+    *p = waiter->next;
+    core_util_critical_section_exit();
+}
+#endif
+
+void poll_change(FileHandle *fh)
+{
+#if MBED_CONF_RTOS_PRESENT
+    core_util_critical_section_enter();
+    for (poll_waiter *waiter = poll_waiters; waiter; waiter = waiter->next) {
+        for (unsigned n = 0; n < waiter->nfhs; n++) {
+            if (waiter->fhs[n].fh == fh) {
+                // Binary semaphore, a pending wakeup needs no second release
+                waiter->wakeup.release();
+                break;
+            }
+        }
+    }
+    core_util_critical_section_exit();
+#endif
+}
+
+static int poll_scan(pollfh fhs[], unsigned nfhs)
+{
+    int count = 0;
+    for (unsigned n = 0; n < nfhs; n++) {
+        FileHandle *fh = fhs[n].fh;
+        short mask = fhs[n].events | POLLERR | POLLHUP | POLLNVAL;
+        if (fh) {
+            fhs[n].revents = fh->poll(mask) & mask;
+        } else {
+            fhs[n].revents = POLLNVAL;
+        }
+        if (fhs[n].revents) {
+            count++;
+        }
+    }
+    return count;
+}
+
 // timeout -1 forever, or milliseconds
 int poll(pollfh fhs[], unsigned nfhs, int timeout)
 {
-    /**
-     * TODO Proper wake-up mechanism.
-     * In order to correctly detect availability of read/write a FileHandle, we needed
-     * a select or poll mechanisms. We opted for poll as POSIX defines in
-     * http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html Currently,
-     * mbed::poll() just spins and scans filehandles looking for any events we are
-     * interested in. In future, his spinning behaviour will be replaced with
-     * condition variables.
-     */
-#if MBED_CONF_RTOS_PRESENT
-    uint64_t start_time = 0;
-    if (timeout > 0) {
-        start_time = Kernel::get_ms_count();
+    int count = poll_scan(fhs, nfhs);
+    if (count || timeout == 0) {
+        return count;
     }
+
+#if MBED_CONF_RTOS_PRESENT
+    uint64_t start_time = Kernel::get_ms_count();
 #define TIME_ELAPSED() int64_t(Kernel::get_ms_count() - start_time)
 #else
 #if MBED_CONF_PLATFORM_POLL_USE_LOWPOWER_TIMER
@@ -50,42 +112,51 @@ int poll(pollfh fhs[], unsigned nfhs, int timeout)
 #else
     Timer timer;
 #endif
-    if (timeout > 0) {
-        timer.start();
-    }
+    timer.start();
 #define TIME_ELAPSED() timer.read_ms()
 #endif // MBED_CONF_RTOS_PRESENT
 
-    int count = 0;
-    for (;;) {
-        /* Scan the file handles */
-        for (unsigned n = 0; n < nfhs; n++) {
-            FileHandle *fh = fhs[n].fh;
-            short mask = fhs[n].events | POLLERR | POLLHUP | POLLNVAL;
-            if (fh) {
-                fhs[n].revents = fh->poll(mask) & mask;
-            } else {
-                fhs[n].revents = POLLNVAL;
-            }
-            if (fhs[n].revents) {
-                count++;
-            }
+#if MBED_CONF_RTOS_PRESENT
+    /* Handles which don't call poll_change() still have to be scanned
+     * every millisecond, the others wake us up when their state changes.
+     */
+    bool scan_periodically = false;
+    for (unsigned n = 0; n < nfhs; n++) {
+        if (fhs[n].fh && !fhs[n].fh->wakes_poll()) {
+            scan_periodically = true;
         }
+    }
 
+    poll_waiter waiter(fhs, nfhs);
+    poll_wait_start(&waiter);
+#endif
+
+    for (;;) {
+        // Scan again, changes before the waiter was registered were missed
+        count = poll_scan(fhs, nfhs);
         if (count) {
             break;
         }
 
-        /* Nothing selected - this is where timeout handling would be needed */
-        if (timeout == 0 || (timeout > 0 && TIME_ELAPSED() > timeout)) {
+        int64_t elapsed = TIME_ELAPSED();
+        if (timeout > 0 && elapsed > timeout) {
             break;
         }
-#ifdef MBED_CONF_RTOS_PRESENT
-        // TODO - proper blocking
-        // wait for condition variable, wait queue whatever here
-        rtos::Thread::wait(1);
+#if MBED_CONF_RTOS_PRESENT
+        uint32_t wait = osWaitForever;
+        if (timeout > 0) {
+            wait = timeout - elapsed + 1;
+        }
+        if (scan_periodically && wait > 1) {
+            wait = 1;
+        }
+        waiter.wakeup.wait(wait);
 #endif
     }
+
+#if MBED_CONF_RTOS_PRESENT
+    poll_wait_end(&waiter);
+#endif
     return count;
 }
 
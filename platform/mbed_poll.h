@@ -51,6 +51,16 @@ struct pollfh {
  */
 int poll(pollfh fhs[], unsigned nfhs, int timeout);
 
+/** Wake up the threads blocked in poll() on a file handle
+ *
+ * FileHandles whose wakes_poll() returns true must call this whenever the events
+ * returned by their poll() may have changed, poll() then blocks on them until woken
+ * rather than scanning them every millisecond. Can be called from interrupt context.
+ *
+ * @param fh      the file handle whose state changed
+ */
+void poll_change(FileHandle *fh);
+
 /**@}*/
 
 /**@}*/
@@ -51,7 +51,6 @@ static SingletonPtr<PlatformMutex> _mutex;
 #   include <rt_misc.h>
 #   include <stdint.h>
 #   define PREFIX(x)    _sys##x
-#   define OPEN_MAX     _SYS_OPEN
 #   ifdef __MICROLIB
 #       pragma import(__use_full_stdio)
 #   endif
@@ -59,14 +58,12 @@ static SingletonPtr<PlatformMutex> _mutex;
 #elif defined(__ICCARM__)
 #   include <yfuns.h>
 #   define PREFIX(x)        _##x
-#   define OPEN_MAX         16
 
 #   define STDIN_FILENO     0
 #   define STDOUT_FILENO    1
 #   define STDERR_FILENO    2
 
 #else
-#   include <sys/syslimits.h>
 #   define PREFIX(x)    x
 #endif
 
@@ -101,12 +98,89 @@ uint32_t mbed_heap_size = 0;
 
 /* newlib has the filehandle field in the FILE struct as a short, so
  * we can't just return a Filehandle* from _open and instead have to
- * put it in a filehandles array and return the index into that array
+ * put it in a filehandles table and return the index into that table.
+ *
+ * The table is made of blocks of FILEHANDLE_BLOCK descriptors, allocated
+ * as descriptors are needed up to MBED_CONF_PLATFORM_FILEHANDLE_MAX.
+ * Blocks are never moved or freed, so descriptors are looked up without
+ * locking. filehandle_mutex only guards reserving and releasing them, which
+ * takes the lowest free descriptor from the free bitmap of a block.
+ */
+#define FILEHANDLE_BLOCK        16
+#define FILEHANDLE_BLOCKS       ((MBED_CONF_PLATFORM_FILEHANDLE_MAX + FILEHANDLE_BLOCK - 1) / FILEHANDLE_BLOCK)
+
+/* Output to descriptors with newline conversion is converted into a buffer
+ * which is written to the FileHandle in one call, rather than a call per line.
+ * MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY sets when the buffer is written out:
+ * at the end of each write, at newlines, or only once full. With the last two,
+ * output held back is also written by fsync, close, reads of a converted
+ * descriptor and at exit, and the buffer is allocated on first use.
  */
-static FileHandle *filehandles[OPEN_MAX] = { FILE_HANDLE_RESERVED, FILE_HANDLE_RESERVED, FILE_HANDLE_RESERVED };
-static char stdio_in_prev[OPEN_MAX];
-static char stdio_out_prev[OPEN_MAX];
+#define STDIO_FLUSH_WRITE       0
+#define STDIO_FLUSH_LINE        1
+#define STDIO_FLUSH_FULL        2
+
+#if MBED_CONF_PLATFORM_STDIO_BUFFER_SIZE < 2
+#error "platform.stdio-buffer-size must be at least 2"
+#endif
+
+struct stdio_buffer {
+    unsigned length;
+    char data[MBED_CONF_PLATFORM_STDIO_BUFFER_SIZE];
+};
+
+struct filehandle_block {
+    FileHandle *volatile fh[FILEHANDLE_BLOCK];
+    stdio_buffer *stdio_out[FILEHANDLE_BLOCK];
+    char stdio_in_prev[FILEHANDLE_BLOCK];
+    char stdio_out_prev[FILEHANDLE_BLOCK];
+};
+
+static filehandle_block first_filehandles = {
+    { FILE_HANDLE_RESERVED, FILE_HANDLE_RESERVED, FILE_HANDLE_RESERVED }
+};
+static filehandle_block *volatile filehandles[FILEHANDLE_BLOCKS] = { &first_filehandles };
+/* Bit set for each free descriptor, stdin, stdout and stderr are never reused */
+static uint32_t filehandles_free[FILEHANDLE_BLOCKS] = {
+    ((MBED_CONF_PLATFORM_FILEHANDLE_MAX < FILEHANDLE_BLOCK) ?
+        (1UL << MBED_CONF_PLATFORM_FILEHANDLE_MAX) - 1 : (1UL << FILEHANDLE_BLOCK) - 1) & ~0x7UL
+};
 static SingletonPtr<PlatformMutex> filehandle_mutex;
+static SingletonPtr<PlatformMutex> stdio_buffer_mutex;
+
+static filehandle_block *get_filehandle_block(int fd) {
+    if (fd < 0 || fd >= FILEHANDLE_BLOCKS * FILEHANDLE_BLOCK) {
+        return NULL;
+    }
+    return filehandles[fd / FILEHANDLE_BLOCK];
+}
+
+static char &stdio_in_prev(int fd) {
+    return filehandles[fd / FILEHANDLE_BLOCK]->stdio_in_prev[fd % FILEHANDLE_BLOCK];
+}
+
+static char &stdio_out_prev(int fd) {
+    return filehandles[fd / FILEHANDLE_BLOCK]->stdio_out_prev[fd % FILEHANDLE_BLOCK];
+}
+
+/* Must be called with filehandle_mutex held */
+static void release_filehandle_locked(int fd) {
+    filehandle_block *block = filehandles[fd / FILEHANDLE_BLOCK];
+    block->fh[fd % FILEHANDLE_BLOCK] = NULL;
+    stdio_buffer_mutex->lock();
+    free(block->stdio_out[fd % FILEHANDLE_BLOCK]);
+    block->stdio_out[fd % FILEHANDLE_BLOCK] = NULL;
+    stdio_buffer_mutex->unlock();
+    if (fd >= 3) {
+        filehandles_free[fd / FILEHANDLE_BLOCK] |= 1UL << (fd % FILEHANDLE_BLOCK);
+    }
+}
+
+static void release_filehandle(int fd) {
+    filehandle_mutex->lock();
+    release_filehandle_locked(fd);
+    filehandle_mutex->unlock();
+}
 
 namespace mbed {
 void mbed_set_unbuffered_stream(std::FILE *_file);
@@ -114,9 +188,10 @@ void mbed_set_unbuffered_stream(std::FILE *_file);
 void remove_filehandle(FileHandle *file) {
     filehandle_mutex->lock();
     /* Remove all open filehandles for this */
-    for (unsigned int fh_i = 0; fh_i < sizeof(filehandles)/sizeof(*filehandles); fh_i++) {
-        if (filehandles[fh_i] == file) {
-            filehandles[fh_i] = NULL;
+    for (int fh_i = 0; fh_i < FILEHANDLE_BLOCKS * FILEHANDLE_BLOCK; fh_i++) {
+        filehandle_block *block = filehandles[fh_i / FILEHANDLE_BLOCK];
+        if (block && block->fh[fh_i % FILEHANDLE_BLOCK] == file) {
+            release_filehandle_locked(fh_i);
         }
     }
     filehandle_mutex->unlock();
@@ -264,12 +339,13 @@ static FileHandle* get_console(int fd) {
 
 /* Deal with the fact C library may not _open descriptors 0, 1, 2 - auto bind */
 static FileHandle* get_fhc(int fd) {
-    if (fd >= OPEN_MAX) {
+    filehandle_block *block = get_filehandle_block(fd);
+    if (block == NULL) {
         return NULL;
     }
-    FileHandle *fh = filehandles[fd];
+    FileHandle *fh = block->fh[fd % FILEHANDLE_BLOCK];
     if (fh == FILE_HANDLE_RESERVED && fd < 3) {
-        filehandles[fd] = fh = get_console(fd);
+        block->fh[fd] = fh = get_console(fd);
     }
     return fh;
 }
@@ -284,7 +360,7 @@ static FileHandle* get_fhc(int fd) {
 static int handle_open_errors(int error, unsigned filehandle_idx) {
     errno = -error;
     // Free file handle
-    filehandles[filehandle_idx] = NULL;
+    release_filehandle(filehandle_idx);
     return -1;
 }
 
@@ -323,24 +399,56 @@ static inline int openflags_to_posix(int openflags) {
     return posix;
 }
 
+/* Index of the lowest bit set in a non-zero word */
+static int lowest_bit(uint32_t word) {
+    static const uint8_t debruijn[32] = {
+        0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+        31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+    };
+    return debruijn[(uint32_t)((word & -word) * 0x077CB531U) >> 27];
+}
+
+static uint32_t filehandle_block_mask(int block) {
+    int count = MBED_CONF_PLATFORM_FILEHANDLE_MAX - block * FILEHANDLE_BLOCK;
+    if (count >= FILEHANDLE_BLOCK) {
+        return (1UL << FILEHANDLE_BLOCK) - 1;
+    }
+    return (1UL << count) - 1;
+}
+
 static int reserve_filehandle() {
-    // find the first empty slot in filehandles, after the slots reserved for stdin/stdout/stderr
+    // take the lowest free descriptor, allocating a new block when the others are full
     filehandle_mutex->lock();
-    int fh_i;
-    for (fh_i = 3; fh_i < OPEN_MAX; fh_i++) {
-        /* Take a next free filehandle slot available. */
-        if (filehandles[fh_i] == NULL) break;
-    }
-    if (fh_i >= OPEN_MAX) {
-        /* Too many file handles have been opened */
-        errno = EMFILE;
-        filehandle_mutex->unlock();
-        return -1;
+    for (int block = 0; block < FILEHANDLE_BLOCKS; block++) {
+        if (filehandles[block] == NULL) {
+            filehandle_block *fhs = (filehandle_block *)calloc(1, sizeof(filehandle_block));
+            if (fhs == NULL) {
+                break;
+            }
+            filehandles_free[block] = filehandle_block_mask(block);
+            filehandles[block] = fhs;
+        }
+
+        if (filehandles_free[block]) {
+            int i = lowest_bit(filehandles_free[block]);
+            filehandles_free[block] &= ~(1UL << i);
+            filehandles[block]->fh[i] = FILE_HANDLE_RESERVED;
+            filehandle_mutex->unlock();
+            return block * FILEHANDLE_BLOCK + i;
+        }
     }
-    filehandles[fh_i] = FILE_HANDLE_RESERVED;
+
+    /* Too many file handles have been opened */
+    errno = EMFILE;
     filehandle_mutex->unlock();
+    return -1;
+}
 
-    return fh_i;
+static void bind_filehandle(int fd, FileHandle *fh) {
+    filehandle_block *block = filehandles[fd / FILEHANDLE_BLOCK];
+    block->stdio_in_prev[fd % FILEHANDLE_BLOCK] = 0;
+    block->stdio_out_prev[fd % FILEHANDLE_BLOCK] = 0;
+    block->fh[fd % FILEHANDLE_BLOCK] = fh;
 }
 
 int mbed::bind_to_fd(FileHandle *fh) {
@@ -349,16 +457,14 @@ int mbed::bind_to_fd(FileHandle *fh) {
         return fh_i;
     }
 
-    filehandles[fh_i] = fh;
-    stdio_in_prev[fh_i] = 0;
-    stdio_out_prev[fh_i] = 0;
+    bind_filehandle(fh_i, fh);
 
     return fh_i;
 }
 
 static int unbind_from_fd(int fd, FileHandle *fh) {
-    if (filehandles[fd] == fh) {
-        filehandles[fd] = NULL;
+    if (get_fhc(fd) == fh) {
+        release_filehandle(fd);
         return 0;
     } else {
         errno = EBADF;
@@ -492,24 +598,247 @@ extern "C" int open(const char *name, int oflag, ...) {
         }
     }
 
-    filehandles[fh_i] = res;
-    stdio_in_prev[fh_i] = 0;
-    stdio_out_prev[fh_i] = 0;
+    bind_filehandle(fh_i, res);
 
     return fh_i;
 }
 
+#if MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY != STDIO_FLUSH_WRITE
+/* Writes out the converted output in out, which belongs to fd. Must be
+ * called with stdio_buffer_mutex held.
+ */
+static int stdio_flush_locked(int fd, stdio_buffer *out) {
+    unsigned flushed = 0;
+    while (flushed < out->length) {
+        ssize_t r = write(fd, out->data + flushed, out->length - flushed);
+        if (r <= 0) {
+            // Keep what wasn't written for the next flush
+            memmove(out->data, out->data + flushed, out->length - flushed);
+            out->length -= flushed;
+            return r < 0 ? -1 : 0;
+        }
+        flushed += r;
+    }
+    out->length = 0;
+    return 0;
+}
+#endif
+
+static int stdio_flush(int fd) {
+    int err = 0;
+#if MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY != STDIO_FLUSH_WRITE
+    stdio_buffer_mutex->lock();
+    filehandle_block *block = get_filehandle_block(fd);
+    if (block && block->stdio_out[fd % FILEHANDLE_BLOCK]) {
+        err = stdio_flush_locked(fd, block->stdio_out[fd % FILEHANDLE_BLOCK]);
+    }
+    stdio_buffer_mutex->unlock();
+#else
+    (void)fd;
+#endif
+    return err;
+}
+
+static void stdio_flush_all() {
+#if MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY != STDIO_FLUSH_WRITE
+    for (int fd = 0; fd < FILEHANDLE_BLOCKS * FILEHANDLE_BLOCK; fd++) {
+        stdio_flush(fd);
+    }
+#endif
+}
+
+#if MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY == STDIO_FLUSH_WRITE
+/* Writes size bytes of data to fd, returns how many were written. err is set
+ * to -1 if a write failed.
+ */
+static size_t stdio_write_out(int fd, const char *data, size_t size, int &err) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t r = write(fd, data + written, size - written);
+        if (r <= 0) {
+            err = r < 0 ? -1 : 0;
+            break;
+        }
+        written += r;
+    }
+    return written;
+}
+
+/* Writes out out, the conversion of buffer from taken up to converted, prev
+ * being the last character written before it. Returns whether it was all
+ * written, taken and prev are moved on past the output which was.
+ */
+static bool stdio_write_staged(int fd, stdio_buffer *out, const unsigned char *buffer,
+                               ssize_t &taken, ssize_t converted, char &prev, int &err) {
+    size_t written = stdio_write_out(fd, out->data, out->length, err);
+    if (written == out->length) {
+        if (written > 0) {
+            prev = out->data[written - 1];
+        }
+        out->length = 0;
+        taken = converted;
+        return true;
+    }
+
+    // Only count the bytes whose output was all written. A '\r' written
+    // without its '\n' is remembered, so it isn't inserted again.
+    for (size_t pos = 0; taken < converted; taken++) {
+        char c = buffer[taken];
+        pos += (c == '\n' && prev != '\r') ? 2 : 1;
+        if (pos > written) {
+            break;
+        }
+        prev = c;
+    }
+    if (written > 0) {
+        prev = out->data[written - 1];
+    }
+    return false;
+}
+
+/* Converts newlines of buffer and writes it out before returning. Runs with
+ * no '\n' to convert are written straight from buffer, short ones are
+ * gathered with the inserted '\r's in a buffer on the stack, so a line is
+ * written in one call rather than in pieces around each '\r'. Nothing is held
+ * between writes, so no lock is needed. Returns the number of bytes of buffer
+ * whose converted output was written, or -1 on error.
+ */
+static ssize_t stdio_buffered_write(int fd, const unsigned char *buffer, ssize_t length) {
+    stdio_buffer out;
+    out.length = 0;
+    // stdio_out_prev(fd) is the last character written
+    char prev = stdio_out_prev(fd);
+    char converted_prev = prev;
+    ssize_t taken = 0;
+    ssize_t converted = 0;
+    int err = 0;
+    bool done = true;
+
+    while (converted < length) {
+        // The run up to the next '\n' without a '\r' before it
+        ssize_t end = converted;
+        char c = converted_prev;
+        while (end < length && !(buffer[end] == '\n' && c != '\r')) {
+            c = buffer[end++];
+        }
+        size_t run = end - converted;
+        unsigned crlf = end < length ? 2 : 0;
+
+        if (out.length + run + crlf > sizeof(out.data)) {
+            done = stdio_write_staged(fd, &out, buffer, taken, converted, prev, err);
+            if (!done) {
+                break;
+            }
+            if (run + crlf > sizeof(out.data)) {
+                size_t written = stdio_write_out(fd, (const char *)buffer + converted, run, err);
+                if (written > 0) {
+                    prev = buffer[converted + written - 1];
+                }
+                taken = converted + written;
+                if (written < run) {
+                    done = false;
+                    break;
+                }
+                converted = end;
+                converted_prev = c;
+                run = 0;
+            }
+        }
+
+        memcpy(out.data + out.length, buffer + converted, run);
+        out.length += run;
+        if (crlf) {
+            out.data[out.length++] = '\r';
+            out.data[out.length++] = '\n';
+            c = '\n';
+            end++;
+        }
+        converted = end;
+        converted_prev = c;
+    }
+    if (done) {
+        stdio_write_staged(fd, &out, buffer, taken, converted, prev, err);
+    }
+    stdio_out_prev(fd) = prev;
+
+    if (taken == 0 && err < 0) {
+        return -1;
+    }
+    return taken;
+}
+#else
+/* Converts newlines of buffer into the output buffer of fd, writing it out
+ * when full and as the flush policy asks. Returns the number of bytes taken
+ * from buffer, or -1 on error.
+ */
+static ssize_t stdio_buffered_write(int fd, const unsigned char *buffer, ssize_t length) {
+    stdio_buffer_mutex->lock();
+    filehandle_block *block = get_filehandle_block(fd);
+    stdio_buffer *out = block->stdio_out[fd % FILEHANDLE_BLOCK];
+    if (out == NULL) {
+        out = (stdio_buffer *)malloc(sizeof(stdio_buffer));
+        if (out == NULL) {
+            stdio_buffer_mutex->unlock();
+            errno = ENOMEM;
+            return -1;
+        }
+        out->length = 0;
+        block->stdio_out[fd % FILEHANDLE_BLOCK] = out;
+    }
+
+    // stdio_out_prev(fd) is the last character converted
+    char prev = stdio_out_prev(fd);
+    bool newline = false;
+    ssize_t taken = 0;
+    int err = 0;
+    while (taken < length) {
+        char c = buffer[taken];
+        // Insert a '\r' before each '\n' without one
+        unsigned needed = (c == '\n' && prev != '\r') ? 2 : 1;
+        if (out->length + needed > sizeof(out->data)) {
+            unsigned held = out->length;
+            err = stdio_flush_locked(fd, out);
+            if (err < 0 || out->length == held) {
+                // Nothing more can be written for now
+                break;
+            }
+            continue;
+        }
+
+        if (needed == 2) {
+            out->data[out->length++] = '\r';
+        }
+        out->data[out->length++] = c;
+        newline = newline || c == '\n';
+        prev = c;
+        taken++;
+    }
+    stdio_out_prev(fd) = prev;
+
+    if (MBED_CONF_PLATFORM_STDIO_FLUSH_POLICY == STDIO_FLUSH_LINE && newline && err == 0) {
+        err = stdio_flush_locked(fd, out);
+    }
+    stdio_buffer_mutex->unlock();
+
+    if (taken == 0 && err < 0) {
+        return -1;
+    }
+    return taken;
+}
+#endif
+
 extern "C" int PREFIX(_close)(FILEHANDLE fh) {
     return close(fh);
 }
 
 extern "C" int close(int fh) {
     FileHandle* fhc = get_fhc(fh);
-    filehandles[fh] = NULL;
     if (fhc == NULL) {
         errno = EBADF;
         return -1;
     }
+    stdio_flush(fh);
+    release_filehandle(fh);
 
     int err = fhc->close();
     if (err < 0) {
@@ -551,42 +880,13 @@ extern "C" int PREFIX(_write)(FILEHANDLE fh, const unsigned char *buffer, unsign
     ssize_t written = 0;
 
     if (convert_crlf(fh)) {
-        // local prev is previous in buffer during seek
-        // stdio_out_prev[fh] is last thing actually written
-        char prev = stdio_out_prev[fh];
-        // Seek for '\n' without preceding '\r'; if found flush
-        // preceding and insert '\r'. Continue until end of input.
-        for (ssize_t cur = 0; cur < slength; cur++) {
-            if (buffer[cur] == '\n' && prev != '\r') {
-                ssize_t r;
-                // flush stuff preceding the \n
-                if (cur > written) {
-                    r = write(fh, buffer + written, cur - written);
-                    if (r < 0) {
-                        return -1;
-                    }
-                    written += r;
-                    if (written < cur) {
-                        // For some reason, didn't write all - give up now
-                        goto finish;
-                    }
-                    stdio_out_prev[fh] = prev;
-                }
-                // insert a \r now, leaving the \n still to be written
-                r = write(fh, "\r", 1);
-                if (r < 0) {
-                    return -1;
-                }
-                if (r < 1) {
-                    goto finish;
-                }
-                stdio_out_prev[fh] = '\r';
-            }
-            prev = buffer[cur];
+        written = stdio_buffered_write(fh, buffer, slength);
+        if (written < 0) {
+            return -1;
         }
+        goto finish;
     }
 
-    // Flush remaining from conversion, or the whole thing if no conversion
     if (written < slength) {
         ssize_t r = write(fh, buffer + written, slength - written);
         if (r < 0) {
@@ -594,7 +894,7 @@ extern "C" int PREFIX(_write)(FILEHANDLE fh, const unsigned char *buffer, unsign
         }
         written += r;
         if (written > 0) {
-            stdio_out_prev[fh] = buffer[written - 1];
+            stdio_out_prev(fh) = buffer[written - 1];
         }
     }
 
@@ -658,6 +958,8 @@ extern "C" int PREFIX(_read)(FILEHANDLE fh, unsigned char *buffer, unsigned int
     ssize_t bytes_read = 0;
 
     if (convert_crlf(fh)) {
+        // Show any prompt held back before waiting for input
+        stdio_flush_all();
         while (true) {
             char c;
             ssize_t r = read(fh, &c, 1);
@@ -667,17 +969,17 @@ extern "C" int PREFIX(_read)(FILEHANDLE fh, unsigned char *buffer, unsigned int
             if (r == 0) {
                 return bytes_read;
             }
-            if ((c == '\r' && stdio_in_prev[fh] != '\n') ||
-                (c == '\n' && stdio_in_prev[fh] != '\r')) {
-                stdio_in_prev[fh] = c;
+            if ((c == '\r' && stdio_in_prev(fh) != '\n') ||
+                (c == '\n' && stdio_in_prev(fh) != '\r')) {
+                stdio_in_prev(fh) = c;
                 *buffer = '\n';
                 break;
-            } else if ((c == '\r' && stdio_in_prev[fh] == '\n') ||
-                       (c == '\n' && stdio_in_prev[fh] == '\r')) {
-                stdio_in_prev[fh] = c;
+            } else if ((c == '\r' && stdio_in_prev(fh) == '\n') ||
+                       (c == '\n' && stdio_in_prev(fh) == '\r')) {
+                stdio_in_prev(fh) = c;
                 continue;
             } else {
-                stdio_in_prev[fh] = c;
+                stdio_in_prev(fh) = c;
                 *buffer = c;
                 break;
             }
@@ -793,6 +1095,10 @@ extern "C" int fsync(int fh) {
         return -1;
     }
 
+    if (stdio_flush(fh) < 0) {
+        return -1;
+    }
+
     int err = fhc->sync();
     if (err < 0) {
         errno = -err;
@@ -864,12 +1170,12 @@ extern "C" int fstat(int fh, struct stat *st) {
 
 extern "C" int poll(struct pollfd fds[], nfds_t nfds, int timeout)
 {
-    if (nfds > OPEN_MAX) {
+    if (nfds > MBED_CONF_PLATFORM_FILEHANDLE_MAX) {
         errno = EINVAL;
         return -1;
     }
 
-    struct mbed::pollfh fhs[OPEN_MAX];
+    struct mbed::pollfh fhs[MBED_CONF_PLATFORM_FILEHANDLE_MAX];
     for (nfds_t n = 0; n < nfds; n++) {
         // Underlying FileHandle poll returns POLLNVAL if given NULL, so
         // we don't need to take special action.
@@ -1129,6 +1435,7 @@ extern "C" void exit(int return_code) {
 #if MBED_CONF_PLATFORM_STDIO_FLUSH_AT_EXIT
     fflush(stdout);
     fflush(stderr);
+    stdio_flush_all();
 #endif
 #endif
 